@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <err.h>
+#include <getopt.h>
+
+/*
+ * Générateur d'instances de couverture exacte, au format lu par exact_cover :
+ *
+ *   bell N            partitions d'un ensemble à N éléments (toutes les parties non vides)
+ *   matching N        couplages parfaits du graphe complet à 2N sommets
+ *   polyomino W H     pavage d'un rectangle W x H par les 12 pentaminos
+ *   latin N           carrés latins d'ordre N
+ *
+ * L'instance est écrite sur la sortie standard (ou dans le fichier donné par
+ * --out), ce qui permet de l'envoyer directement au solveur :
+ *
+ *   ./ec-gen bell 15 | ./exact_cover --in -
+ */
+
+FILE *out;
+
+static const char DIGITS[36] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+                                'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j',
+                                'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't',
+                                'u', 'v', 'w', 'x', 'y', 'z'};
+
+void usage(char **argv)
+{
+        printf("%s FAMILY N [M] [--out FILENAME]\n\n", argv[0]);
+        printf("Families:\n");
+        printf("bell N            set partitions of an N-element set\n");
+        printf("matching N        perfect matchings of the complete graph on 2N vertices\n");
+        printf("polyomino W H     tilings of a W x H board by the 12 pentominoes\n");
+        printf("latin N           Latin squares of order N\n");
+        exit(0);
+}
+
+
+/******************************* bell *******************************/
+
+void gen_bell(int n)
+{
+        if (n < 1 || n > 30)
+                errx(1, "bell : il faut 1 <= N <= 30");
+        long long m = (1LL << n) - 1;
+        fprintf(out, "%d %lld\n", n, m);
+        for (int i = 0; i < n; i++)
+                fprintf(out, "x%d%c", i, (i == n - 1) ? '\n' : ' ');
+        /* parties rangées par taille, puis dans l'ordre lexicographique (comme bell12.ec) */
+        int c[30];
+        for (int k = 1; k <= n; k++) {
+                for (int i = 0; i < k; i++)
+                        c[i] = i;
+                while (true) {
+                        for (int i = 0; i < k; i++)
+                                fprintf(out, (i == 0) ? "x%d" : " x%d", c[i]);
+                        fprintf(out, "\n");
+                        int i = k - 1;
+                        while (i >= 0 && c[i] == n - k + i)
+                                i--;
+                        if (i < 0)
+                                break;
+                        c[i]++;
+                        for (int j = i + 1; j < k; j++)
+                                c[j] = c[j - 1] + 1;
+                }
+        }
+}
+
+
+/***************************** matching *****************************/
+
+void gen_matching(int n)
+{
+        if (n < 1)
+                errx(1, "matching : il faut N >= 1");
+        int v = 2 * n;
+        fprintf(out, "%d %d\n", v, v * (v - 1) / 2);
+        for (int i = 0; i < v; i++)
+                fprintf(out, "x%d%c", i, (i == v - 1) ? '\n' : ' ');
+        for (int i = 0; i < v; i++)
+                for (int j = i + 1; j < v; j++)
+                        fprintf(out, "x%d x%d\n", i, j);
+}
+
+
+/***************************** polyomino ****************************/
+
+/* les 12 pentaminos, chacun donné par ses 5 cases (ligne, colonne) */
+static const char PIECE_NAME[12] = {'F', 'I', 'L', 'N', 'P', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z'};
+static const int PIECE[12][5][2] = {
+        {{0, 1}, {0, 2}, {1, 0}, {1, 1}, {2, 1}},       // F
+        {{0, 0}, {1, 0}, {2, 0}, {3, 0}, {4, 0}},       // I
+        {{0, 0}, {1, 0}, {2, 0}, {3, 0}, {3, 1}},       // L
+        {{0, 1}, {1, 1}, {2, 0}, {2, 1}, {3, 0}},       // N
+        {{0, 0}, {0, 1}, {1, 0}, {1, 1}, {2, 0}},       // P
+        {{0, 0}, {0, 1}, {0, 2}, {1, 1}, {2, 1}},       // T
+        {{0, 0}, {0, 2}, {1, 0}, {1, 1}, {1, 2}},       // U
+        {{0, 0}, {1, 0}, {2, 0}, {2, 1}, {2, 2}},       // V
+        {{0, 0}, {1, 0}, {1, 1}, {2, 1}, {2, 2}},       // W
+        {{0, 1}, {1, 0}, {1, 1}, {1, 2}, {2, 1}},       // X
+        {{0, 1}, {1, 0}, {1, 1}, {2, 1}, {3, 1}},       // Y
+        {{0, 0}, {0, 1}, {1, 1}, {2, 1}, {2, 2}},       // Z
+};
+
+struct shape_t {
+        int cell[5][2];         // triées, translatées pour que min(ligne) = min(colonne) = 0
+        int height, width;
+};
+
+static int compare_cell(const void *a, const void *b)
+{
+        const int *x = a;
+        const int *y = b;
+        if (x[0] != y[0])
+                return x[0] - y[0];
+        return x[1] - y[1];
+}
+
+/* les orientations distinctes (au plus 8) d'un pentamino ; renvoie leur nombre */
+int piece_orientations(int piece, struct shape_t *shapes)
+{
+        int count = 0;
+        for (int t = 0; t < 8; t++) {
+                struct shape_t S;
+                int min_r = 0x7fffffff, min_c = 0x7fffffff;
+                for (int i = 0; i < 5; i++) {
+                        int r = PIECE[piece][i][0];
+                        int c = PIECE[piece][i][1];
+                        for (int k = 0; k < (t & 3); k++) {     // rotation d'un quart de tour
+                                int tmp = r;
+                                r = c;
+                                c = -tmp;
+                        }
+                        if (t & 4)                              // symétrie
+                                c = -c;
+                        S.cell[i][0] = r;
+                        S.cell[i][1] = c;
+                        min_r = (r < min_r) ? r : min_r;
+                        min_c = (c < min_c) ? c : min_c;
+                }
+                S.height = S.width = 0;
+                for (int i = 0; i < 5; i++) {
+                        S.cell[i][0] -= min_r;
+                        S.cell[i][1] -= min_c;
+                        if (S.cell[i][0] + 1 > S.height)
+                                S.height = S.cell[i][0] + 1;
+                        if (S.cell[i][1] + 1 > S.width)
+                                S.width = S.cell[i][1] + 1;
+                }
+                qsort(S.cell, 5, sizeof(S.cell[0]), compare_cell);
+                bool known = false;
+                for (int j = 0; j < count; j++)
+                        if (memcmp(&shapes[j], &S, sizeof(S)) == 0)
+                                known = true;
+                if (!known)
+                        shapes[count++] = S;
+        }
+        return count;
+}
+
+void print_cell(int r, int c)
+{
+        if (r < 36 && c < 36)
+                fprintf(out, "%c%c", DIGITS[r], DIGITS[c]);
+        else
+                fprintf(out, "r%dc%d", r, c);
+}
+
+/*
+ * Les cases sont nommées ligne puis colonne (en base 36, à partir de 1), comme
+ * dans pentomino_6_10.ec.  Le plateau doit avoir au moins les 60 cases des
+ * pentaminos, sans quoi les 12 pièces (primaires) ne tiennent pas.  S'il en a
+ * plus de 60, les cases deviennent secondaires (on cherche alors les
+ * placements de toutes les pièces sans chevauchement).
+ */
+void gen_polyomino(int width, int height)
+{
+        if (width < 1 || height < 1)
+                errx(1, "polyomino : il faut W, H >= 1");
+        if ((long long) width * height < 60)
+                errx(1, "polyomino : plateau trop petit (%d cases, les 12 pièces en couvrent 60)", 
+                                width * height);
+        bool cells_primary = (width * height == 60);
+        struct shape_t shapes[12][8];
+        int n_shapes[12];
+        long long m = 0;
+        for (int piece = 0; piece < 12; piece++) {
+                n_shapes[piece] = piece_orientations(piece, shapes[piece]);
+                for (int s = 0; s < n_shapes[piece]; s++) {
+                        int dr = height - shapes[piece][s].height + 1;
+                        int dc = width - shapes[piece][s].width + 1;
+                        if (dr > 0 && dc > 0)
+                                m += dr * dc;
+                }
+        }
+        if (m == 0)
+                errx(1, "polyomino : plateau trop petit");
+        fprintf(out, "%d %lld\n", width * height + 12, m);
+        /* objets primaires : les cases (si le pavage est exact) puis les pièces */
+        if (cells_primary)
+                for (int r = 1; r <= height; r++)
+                        for (int c = 1; c <= width; c++) {
+                                print_cell(r, c);
+                                fprintf(out, " ");
+                        }
+        for (int piece = 0; piece < 12; piece++)
+                fprintf(out, "%c%c", PIECE_NAME[piece], (piece == 11 && cells_primary) ? '\n' : ' ');
+        if (!cells_primary) {
+                fprintf(out, "|");
+                for (int r = 1; r <= height; r++)
+                        for (int c = 1; c <= width; c++) {
+                                fprintf(out, " ");
+                                print_cell(r, c);
+                        }
+                fprintf(out, "\n");
+        }
+        for (int piece = 0; piece < 12; piece++)
+                for (int s = 0; s < n_shapes[piece]; s++) {
+                        struct shape_t *S = &shapes[piece][s];
+                        for (int r = 1; r + S->height - 1 <= height; r++)
+                                for (int c = 1; c + S->width - 1 <= width; c++) {
+                                        fprintf(out, "%c", PIECE_NAME[piece]);
+                                        for (int i = 0; i < 5; i++) {
+                                                fprintf(out, " ");
+                                                print_cell(r + S->cell[i][0], c + S->cell[i][1]);
+                                        }
+                                        fprintf(out, "\n");
+                                }
+                }
+}
+
+
+/****************************** latin *******************************/
+
+/* case (r, c) remplie, valeur v présente sur la ligne r et sur la colonne c */
+void gen_latin(int n)
+{
+        if (n < 1)
+                errx(1, "latin : il faut N >= 1");
+        fprintf(out, "%d %lld\n", 3 * n * n, (long long) n * n * n);
+        for (int r = 0; r < n; r++)
+                for (int c = 0; c < n; c++)
+                        fprintf(out, "p%d_%d ", r, c);
+        for (int r = 0; r < n; r++)
+                for (int v = 0; v < n; v++)
+                        fprintf(out, "r%d_%d ", r, v);
+        for (int c = 0; c < n; c++)
+                for (int v = 0; v < n; v++)
+                        fprintf(out, "c%d_%d%c", c, v, (c == n - 1 && v == n - 1) ? '\n' : ' ');
+        for (int r = 0; r < n; r++)
+                for (int c = 0; c < n; c++)
+                        for (int v = 0; v < n; v++)
+                                fprintf(out, "p%d_%d r%d_%d c%d_%d\n", r, c, r, v, c, v);
+}
+
+
+int main(int argc, char **argv)
+{
+        struct option longopts[2] = {
+                {"out", required_argument, NULL, 'o'},
+                {NULL, 0, NULL, 0}
+        };
+        char *out_filename = NULL;
+        int ch;
+        while ((ch = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+                switch (ch) {
+                case 'o':
+                        out_filename = optarg;
+                        break;
+                default:
+                        errx(1, "Unknown option\n");
+                }
+        }
+        if (argc - optind < 2)
+                usage(argv);
+        const char *family = argv[optind];
+        int a = atoi(argv[optind + 1]);
+        int b = (argc - optind >= 3) ? atoi(argv[optind + 2]) : 0;
+
+        out = stdout;
+        if (out_filename != NULL) {
+                out = fopen(out_filename, "w");
+                if (out == NULL)
+                        err(1, "Impossible d'ouvrir %s en écriture", out_filename);
+        }
+        if (strcmp(family, "bell") == 0)
+                gen_bell(a);
+        else if (strcmp(family, "matching") == 0)
+                gen_matching(a);
+        else if (strcmp(family, "polyomino") == 0) {
+                if (argc - optind < 3)
+                        usage(argv);
+                gen_polyomino(a, b);
+        } else if (strcmp(family, "latin") == 0)
+                gen_latin(a);
+        else
+                errx(1, "Famille inconnue : %s", family);
+        if (fclose(out) != 0)
+                err(1, "erreur lors de l'écriture");
+        exit(EXIT_SUCCESS);
+}
@@ -5,7 +5,19 @@
 #include <stdlib.h>
 #include <err.h>
 #include <getopt.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
 
 /* changelog :
 2021-04-12 18:30, instance->n_primary was not properly initialized
@@ -18,6 +30,20 @@ bool print_solutions = false;          // affiche chaque solution
 long long report_delta = 1e6;          // affiche un rapport tous les ... noeuds
 long long next_report;                 // prochain rapport affiché au noeud...
 long long max_solutions = 0x7fffffffffffffff;        // stop après ... solutions
+bool reduce = false;                   // simplifie l'instance avant la recherche
+bool renumber = false;                 // renumérote objets et options pour la localité
+bool count_memo = false;               // mémorise le nombre de solutions des sous-problèmes
+enum engine_t {ENGINE_AUTO, ENGINE_SPARSE, ENGINE_BITSET};
+enum engine_t engine = ENGINE_AUTO;    // moteur de recherche
+enum branching_t {BRANCH_MRV, BRANCH_MRV_LENGTH, BRANCH_WDEG, BRANCH_RANDOM};
+enum branching_t branching = BRANCH_MRV;       // choix de l'objet sur lequel brancher
+unsigned long long seed = 1;           // graine de --branching random
+char *compile_filename = NULL;         // écrit l'image binaire de l'instance et s'arrête
+char *zdd_filename = NULL;             // construit le diagramme des solutions et l'écrit ici
+char *zdd_read_filename = NULL;        // interroge un diagramme déjà construit
+long long zdd_solution = -1;           // numéro de la solution à extraire du diagramme
+int split_every = 0;                   // cherche des composantes tous les ... niveaux (0 : jamais)
+bool propagate = true;                 // applique les coups forcés sans créer de noeud
 
 
 struct instance_t {
@@ -25,8 +51,18 @@ struct instance_t {
         int n_primary;
         int n_options;
         char **item_name;   // potentiellement NULL, sinon de taille n_items
+        char *name_arena;   // zone contenant tous les noms (item_name pointe dedans)
         int *options;       // l'option i contient les objets options[ptr[i]:ptr[i+1]]
         int *ptr;           // taille n_options + 1
+        int *item_ptr;      // les options de l'objet j sont item_options[item_ptr[j]:item_ptr[j+1]]
+        int *item_options;  // taille ptr[n_options]
+        int *local_slot;    // local_slot[k] = rang de l'option dans la liste de l'objet options[k]
+        struct instance_t *origin;      // instance lue dans le fichier (NULL si c'est celle-ci)
+        int *option_origin;             // numéro d'origine de chaque option (NULL : identité)
+        int *option_weight;             // nombre d'options d'origine identiques (NULL : toutes 1)
+        int n_forced;                   // options d'origine présentes dans toute solution
+        int *forced;
+        long long base_weight;          // produit des poids des options imposées
 };
 
 struct sparse_array_t {
@@ -36,17 +72,37 @@ struct sparse_array_t {
         int *q;            // taille capacity (tout comme p)
 };
 
+/* 
+ * Tout l'état modifiable d'un contexte vit dans un seul bloc (l'arène), aligné
+ * sur une ligne de cache.  L'ensemble des options actives de l'objet i contient
+ * des rangs locaux 0 <= r < deg(i) et non des numéros d'option : p et q ne font
+ * donc que deg(i) cases au lieu de n_options.
+ */
 struct context_t {
         struct sparse_array_t *active_items;      // objets actifs
-        struct sparse_array_t **active_options;   // options actives contenant l'objet i
+        struct sparse_array_t *active_options;    // options actives (rangs locaux) contenant l'objet i
+        bool buckets;                             // file à seaux pour choose_next_item (sinon parcours SIMD)
+        int *by_count;                            // objets primaires triés par nombre d'options actives (couverts en tête)
+        int *by_count_pos;                        // position de chaque objet primaire dans by_count
+        int *bucket_start;                        // début, dans by_count, des objets à c options : [c + 1]
         int *chosen_options;                      // options choisies à ce stade
         int *child_num;                           // numéro du fils exploré
         int *num_children;                        // nombre de fils à explorer
+        int *failures;                            // poids dom/wdeg : 1 + nombre d'échecs causés par l'objet
+        uint64_t rng;                             // état du générateur (--branching random)
         int level;                                // nombre d'options choisies
         long long nodes;                          // nombre de noeuds explorés
         long long solutions;                      // nombre de solutions trouvées 
+        struct bitset_tail_t *tail;               // relais bitset en fond d'arbre (NULL : jamais)
+        struct memo_t *memo;                      // table des sous-problèmes déjà comptés (ou NULL)
+        struct split_t *split;                    // décomposition en composantes (ou NULL)
+        uint64_t *covered;                        // objets couverts (bitset), clé de memo
+        char *arena;                              // bloc contenant tous les tableaux ci-dessus
+        size_t arena_size;
 };
 
+#define CACHE_LINE 64
+
 static const char DIGITS[62] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
                                 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 
                                 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't',
@@ -71,6 +127,20 @@ void usage(char **argv)
         printf("--progress-report N   display a message every N nodes (0 to disable)\n");
         printf("--print-solutions     display solutions when they are found\n");
         printf("--stop-after N        stop the search once N solutions are found\n");
+        printf("--compile FILE        write a binary image (.ecb) of the instance and exit\n");
+        printf("--reduce              simplify the instance (duplicate, dead and forced options) first\n");
+        printf("--renumber            reorder items and options for cache locality (reverse Cuthill-McKee)\n");
+        printf("--count-memo          count only, caching subtree counts keyed by the covered items\n");
+        printf("--components K        when counting, split the residual problem into independent parts every K levels\n");
+        printf("--zdd FILE            build the diagram (ZDD) of all solutions and write it to FILE\n");
+        printf("--zdd-read FILE       print the number of solutions stored in a diagram (--in optional)\n");
+        printf("--zdd-solution K      with --zdd-read, also print solution K (0-based)\n");
+        printf("--no-propagate        branch on forced moves too (one search node per forced option)\n");
+        printf("--branching NAME      item choice: mrv (default), mrv-length (ties: longest options),\n");
+        printf("                      wdeg (options / failures, dom/wdeg), random (ties at random; sparse engine)\n");
+        printf("--seed N              seed for --branching random\n");
+        printf("--engine NAME         search engine: auto (default), sparse, bitset (at most 256 items)\n");
+        printf("                      (auto finishes wider instances with bitsets once 64 primary items remain)\n");
         exit(0);
 }
 
@@ -94,20 +164,19 @@ void print_option(const struct instance_t *instance, int option)
 
 
 
-struct sparse_array_t * sparse_array_init(int n)
+/* installe un tableau creux de capacité n dans la zone p[0:n], q[0:n] (déjà allouée) */
+void sparse_array_bind(struct sparse_array_t *S, int *zone, int n)
 {
-        struct sparse_array_t *S = malloc(sizeof(*S));
-        if (S == NULL)
-                err(1, "impossible d'allouer un tableau creux");
-        S->len = 0;
         S->capacity = n;
-        S->p = malloc(n * sizeof(int));
-        S->q = malloc(n * sizeof(int));
-        if (S->p == NULL || S->q == NULL)
-                err(1, "Impossible d'allouer p/q dans un tableau creux");
-        for (int i = 0; i < n; i++)
-                S->q[i] = n;           // initialement vide
-        return S;
+        S->p = zone;
+        S->q = zone + n;
+}
+
+void sparse_array_clear(struct sparse_array_t *S)
+{
+        S->len = 0;
+        for (int i = 0; i < S->capacity; i++)
+                S->q[i] = S->capacity;           // initialement vide
 }
 
 bool sparse_array_membership(const struct sparse_array_t *S, int x)
@@ -159,18 +228,60 @@ bool item_is_active(const struct context_t *ctx, int item)
         return sparse_array_membership(ctx->active_items, item);
 }
 
+/*
+ * Les réductions (--reduce) et renumérotations produisent une nouvelle
+ * instance dont les options sont reliées à celles du fichier : option_origin
+ * donne le numéro d'origine de chaque option, option_weight le nombre
+ * d'options d'origine identiques qu'elle représente, et forced la liste des
+ * options imposées, présentes dans toute solution.
+ */
+void instance_set_identity(struct instance_t *instance)
+{
+        instance->origin = NULL;
+        instance->option_origin = NULL;
+        instance->option_weight = NULL;
+        instance->n_forced = 0;
+        instance->forced = NULL;
+        instance->base_weight = 1;
+}
+
+/* numéro, dans le fichier, de l'option option de instance */
+static inline int original_option(const struct instance_t *instance, int option)
+{
+        return (instance->option_origin == NULL) ? option : instance->option_origin[option];
+}
+
+/* nombre de solutions du fichier d'origine représentées par la solution courante */
+long long solution_weight(const struct instance_t *instance, const struct context_t *ctx)
+{
+        long long w = instance->base_weight;
+        if (instance->option_weight != NULL)
+                for (int i = 0; i < ctx->level; i++)
+                        w *= instance->option_weight[ctx->chosen_options[i]];
+        return w;
+}
+
 void solution_found(const struct instance_t *instance, struct context_t *ctx)
 {
-        ctx->solutions++;
+        ctx->solutions += solution_weight(instance, ctx);
         if (!print_solutions)
                 return;
         printf("Trouvé une nouvelle solution au niveau %d après %lld noeuds\n", 
                         ctx->level, ctx->nodes);
         printf("Options : \n");
+        /* les options sont affichées avec leur numéro dans le fichier */
+        const struct instance_t *origin = (instance->origin != NULL) ? instance->origin : instance;
+        for (int i = 0; i < instance->n_forced; i++) {
+                printf("+ %d : ", instance->forced[i]);
+                print_option(origin, instance->forced[i]);
+        }
         for (int i = 0; i < ctx->level; i++) {
-                int option = ctx->chosen_options[i];
-                printf("+ %d : ", option);
-                print_option(instance, option);
+                int option = original_option(instance, ctx->chosen_options[i]);
+                if (instance->option_weight != NULL && instance->option_weight[ctx->chosen_options[i]] > 1)
+                        printf("+ %d (x%d) : ", option, instance->option_weight[ctx->chosen_options[i]]);
+                else
+                        printf("+ %d : ", option);
+                print_option(origin, option);
         }
         printf("\n");
         printf("----------------------------------------------------\n");
@@ -206,15 +317,37 @@ void unchoose_option(const struct instance_t *instance, struct context_t *ctx,
 }
 
 
-int choose_next_item(struct context_t *ctx)
+/* numéro de l'option de rang local r dans la liste de l'objet item */
+static inline int item_option(const struct instance_t *instance, int item, int r)
+{
+        return instance->item_options[instance->item_ptr[item] + r];
+}
+
+/*
+ * Recherche de l'objet actif ayant le moins d'options actives, dans l'ordre
+ * de active_items->p.  Tant qu'il y a peu d'objets actifs, une boucle scalaire
+ * en ligne rend directement le premier objet minimal.  Au-delà de
+ * GATHER_MIN_ITEMS, on calcule d'abord le minimum par gather AVX2 ou AVX-512
+ * (si le processeur le permet, choisi au démarrage), puis un second passage
+ * retient le premier objet qui l'atteint, comme en scalaire.  Les gathers
+ * lisent directement le champ len des en-têtes active_options[item] (pas de
+ * SPARSE_ARRAY_INTS entiers) : aucune copie dense à tenir à jour.
+ */
+#define GATHER_MIN_ITEMS 128
+#define SPARSE_ARRAY_INTS ((int) (sizeof(struct sparse_array_t) / sizeof(int)))
+_Static_assert(offsetof(struct sparse_array_t, len) == 0 && sizeof(struct sparse_array_t) % sizeof(int) == 0,
+               "les gathers lisent len au début de chaque en-tête");
+
+enum gather_t {GATHER_NONE, GATHER_AVX2, GATHER_AVX512};
+static enum gather_t gather = GATHER_NONE;
+
+static inline int first_min_active_len(const int *items, int n, const struct sparse_array_t *active_options)
 {
         int best_item = -1;
         int best_options = 0x7fffffff;
-        struct sparse_array_t *active_items = ctx->active_items;
-        for (int i = 0; i < active_items->len; i++) {
-                int item = active_items->p[i];
-                struct sparse_array_t *active_options = ctx->active_options[item];
-                int k = active_options->len;
+        for (int i = 0; i < n; i++) {
+                int item = items[i];
+                int k = active_options[item].len;
                 if (k < best_options) {
                         best_item = item;
                         best_options = k;
@@ -223,6 +356,275 @@ int choose_next_item(struct context_t *ctx)
         return best_item;
 }
 
+static inline int min_active_len_scalar(const int *items, int n, const struct sparse_array_t *active_options)
+{
+        int best = 0x7fffffff;
+        for (int i = 0; i < n; i++) {
+                int k = active_options[items[i]].len;
+                best = (k < best) ? k : best;
+        }
+        return best;
+}
+
+#ifdef __x86_64__
+__attribute__((target("avx2")))
+static int min_active_len_avx2(const int *items, int n, const struct sparse_array_t *active_options)
+{
+        const int *len = &active_options->len;
+        __m256i stride = _mm256_set1_epi32(SPARSE_ARRAY_INTS);
+        __m256i vbest = _mm256_set1_epi32(0x7fffffff);
+        int i = 0;
+        for (; i + 8 <= n; i += 8) {
+                __m256i idx = _mm256_loadu_si256((const __m256i *) (items + i));
+                idx = _mm256_mullo_epi32(idx, stride);
+                vbest = _mm256_min_epi32(vbest, _mm256_i32gather_epi32(len, idx, 4));
+        }
+        __m128i m = _mm_min_epi32(_mm256_castsi256_si128(vbest), _mm256_extracti128_si256(vbest, 1));
+        m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+        int best = _mm_cvtsi128_si32(m);
+        for (; i < n; i++) {
+                int k = active_options[items[i]].len;
+                best = (k < best) ? k : best;
+        }
+        return best;
+}
+
+__attribute__((target("avx512f")))
+static int min_active_len_avx512(const int *items, int n, const struct sparse_array_t *active_options)
+{
+        const int *len = &active_options->len;
+        __m512i stride = _mm512_set1_epi32(SPARSE_ARRAY_INTS);
+        __m512i vbest = _mm512_set1_epi32(0x7fffffff);
+        int i = 0;
+        for (; i + 16 <= n; i += 16) {
+                __m512i idx = _mm512_mullo_epi32(_mm512_loadu_si512(items + i), stride);
+                vbest = _mm512_min_epi32(vbest, _mm512_i32gather_epi32(idx, len, 4));
+        }
+        if (i < n) {
+                __mmask16 tail = (1u << (n - i)) - 1;
+                __m512i idx = _mm512_mullo_epi32(_mm512_maskz_loadu_epi32(tail, items + i), stride);
+                __m512i k = _mm512_mask_i32gather_epi32(vbest, tail, idx, len, 4);
+                vbest = _mm512_min_epi32(vbest, k);
+        }
+        return _mm512_reduce_min_epi32(vbest);
+}
+#endif
+
+static inline int min_active_len(const int *items, int n, const struct sparse_array_t *active_options)
+{
+#ifdef __x86_64__
+        if (n >= GATHER_MIN_ITEMS) {
+                if (gather == GATHER_AVX512)
+                        return min_active_len_avx512(items, n, active_options);
+                if (gather == GATHER_AVX2)
+                        return min_active_len_avx2(items, n, active_options);
+        }
+#endif
+        return min_active_len_scalar(items, n, active_options);
+}
+
+void choose_next_item_setup()
+{
+#ifdef __x86_64__
+        if (__builtin_cpu_supports("avx512f"))
+                gather = GATHER_AVX512;
+        else if (__builtin_cpu_supports("avx2"))
+                gather = GATHER_AVX2;
+#endif
+}
+
+/*
+ * File à seaux, pour les instances très larges et creuses.  by_count range les objets primaires par nombre d'options actives croissant,
+ * les objets couverts formant le seau 0 en tête ; le seau b = c + 1 contient
+ * les objets actifs ayant c options et commence en bucket_start[b].  Un objet
+ * passe d'un seau au voisin par un échange avec le premier (ou le dernier)
+ * élément du seau, donc l'objet actif le moins contraint est toujours
+ * by_count[bucket_start[1]].  Chaque opération a son inverse exact, appelé
+ * dans l'ordre inverse par uncover/reactivate.
+ *
+ * Chaque retrait d'option coûte alors un échange de plus : la file n'est
+ * rentable que si le parcours (n_primary / 16 gathers) dépasse le nombre
+ * d'options retirées par un cover, estimé à sum(len^2) / n_items * len moyen.
+ */
+#define BUCKET_SCAN_RATIO 16
+
+bool buckets_pay_off(const struct instance_t *instance)
+{
+        int m = instance->n_options;
+        if (m == 0)
+                return false;
+        double sum_len2 = 0;
+        for (int option = 0; option < m; option++) {
+                double len = instance->ptr[option + 1] - instance->ptr[option];
+                sum_len2 += len * len;
+        }
+        double mean_len = (double) instance->ptr[m] / m;
+        double removals = sum_len2 / instance->n_items * mean_len;
+        return instance->n_primary > BUCKET_SCAN_RATIO * removals;
+}
+
+static inline void bucket_swap(struct context_t *ctx, int item, int j)
+{
+        int i = ctx->by_count_pos[item];
+        int other = ctx->by_count[j];
+        ctx->by_count[i] = other;
+        ctx->by_count_pos[other] = i;
+        ctx->by_count[j] = item;
+        ctx->by_count_pos[item] = j;
+}
+
+/* item (actif) perd une option : il passe en fin du seau inférieur */
+static inline void bucket_decrease(struct context_t *ctx, int item, int count)
+{
+        int b = count + 1;
+        bucket_swap(ctx, item, ctx->bucket_start[b]);
+        ctx->bucket_start[b]++;
+}
+
+/* inverse de bucket_decrease : item, de count - 1 options, en regagne une */
+static inline void bucket_increase(struct context_t *ctx, int item, int count)
+{
+        int b = count + 1;
+        ctx->bucket_start[b]--;
+        bucket_swap(ctx, item, ctx->bucket_start[b]);
+}
+
+/* item (count options) est couvert : il descend jusqu'au seau 0 */
+static inline void bucket_remove(struct context_t *ctx, int item, int count)
+{
+        for (int b = count + 1; b >= 1; b--) {
+                bucket_swap(ctx, item, ctx->bucket_start[b]);
+                ctx->bucket_start[b]++;
+        }
+}
+
+/* inverse de bucket_remove */
+static inline void bucket_restore(struct context_t *ctx, int item, int count)
+{
+        for (int b = 1; b <= count + 1; b++) {
+                ctx->bucket_start[b]--;
+                bucket_swap(ctx, item, ctx->bucket_start[b]);
+        }
+}
+
+/*
+ * Heuristiques de branchement (--branching).  mrv : le premier objet ayant le
+ * moins d'options actives.  mrv-length : parmi les ex-aequo, celui dont les
+ * options actives sont les plus longues au total (elles couvrent davantage
+ * d'objets, donc élaguent plus).  random : un ex-aequo tiré au hasard.
+ * wdeg : minimise le nombre d'options actives / failures (dom/wdeg de Boussemart et al.),
+ * failures comptant les culs-de-sac où l'objet s'est retrouvé sans option ;
+ * les objets à 0 option passent en premier, puis ceux à 1 option.
+ */
+static inline uint64_t xorshift64(uint64_t *state)
+{
+        uint64_t x = *state;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        return *state = x;
+}
+
+static int active_options_length(const struct instance_t *instance, const struct context_t *ctx, int item)
+{
+        const struct sparse_array_t *active_options = &ctx->active_options[item];
+        int total = 0;
+        for (int k = 0; k < active_options->len; k++) {
+                int option = item_option(instance, item, active_options->p[k]);
+                total += instance->ptr[option + 1] - instance->ptr[option];
+        }
+        return total;
+}
+
+static int choose_wdeg(struct context_t *ctx)
+{
+        const struct sparse_array_t *active_items = ctx->active_items;
+        const struct sparse_array_t *active_options = ctx->active_options;
+        int best = -1;
+        int forced = -1;
+        for (int i = 0; i < active_items->len; i++) {
+                int item = active_items->p[i];
+                if (active_options[item].len == 0)
+                        return item;
+                if (active_options[item].len == 1) {
+                        if (forced < 0)
+                                forced = item;
+                        continue;
+                }
+                if (best < 0 || (long long) active_options[item].len * ctx->failures[best] 
+                                < (long long) active_options[best].len * ctx->failures[item])
+                        best = item;
+        }
+        return forced >= 0 ? forced : best;
+}
+
+int choose_next_item(const struct instance_t *instance, struct context_t *ctx)
+{
+        if (branching == BRANCH_WDEG)
+                return choose_wdeg(ctx);
+        if (ctx->buckets && branching == BRANCH_MRV)
+                return ctx->by_count[ctx->bucket_start[1]];
+
+        /* ex-aequo : début du seau minimal de by_count, sinon active_items->p filtré */
+        const struct sparse_array_t *active_options = ctx->active_options;
+        const int *candidates;
+        int lo, hi;
+        int best_options;
+        if (ctx->buckets) {
+                candidates = ctx->by_count;
+                best_options = active_options[ctx->by_count[ctx->bucket_start[1]]].len;
+                lo = ctx->bucket_start[1];
+                hi = instance->n_primary;
+        } else {
+                const struct sparse_array_t *active_items = ctx->active_items;
+                if (branching == BRANCH_MRV && active_items->len < GATHER_MIN_ITEMS)
+                        return first_min_active_len(active_items->p, active_items->len, active_options);
+                candidates = active_items->p;
+                best_options = min_active_len(active_items->p, active_items->len, active_options);
+                lo = 0;
+                hi = active_items->len;
+        }
+        int chosen = -1;
+        int chosen_key = -1;
+        int ties = 0;
+        for (int i = lo; i < hi; i++) {
+                int item = candidates[i];
+                if (active_options[item].len != best_options) {
+                        if (ctx->buckets)
+                                break;          /* fin du seau */
+                        continue;
+                }
+                if (branching == BRANCH_MRV)
+                        return item;
+                if (branching == BRANCH_RANDOM) {
+                        ties++;
+                        if (xorshift64(&ctx->rng) % ties == 0)
+                                chosen = item;
+                } else {
+                        int key = active_options_length(instance, ctx, item);
+                        if (key > chosen_key) {
+                                chosen = item;
+                                chosen_key = key;
+                        }
+                }
+        }
+        return chosen;
+}
+
+/* un cul-de-sac : les objets primaires actifs sans option voient leur poids wdeg augmenter */
+void branching_failure(struct context_t *ctx)
+{
+        if (branching != BRANCH_WDEG)
+                return;
+        const struct sparse_array_t *active_items = ctx->active_items;
+        for (int i = 0; i < active_items->len; i++) {
+                int item = active_items->p[i];
+                if (ctx->active_options[item].len == 0)
+                        ctx->failures[item]++;
+        }
+}
+
 void progress_report(const struct context_t *ctx)
 {
         double now = wtime();
@@ -245,15 +647,30 @@ void progress_report(const struct context_t *ctx)
 
 void deactivate(const struct instance_t *instance, struct context_t *ctx, 
                         int option, int covered_item);
+void deactivate_bucket(const struct instance_t *instance, struct context_t *ctx, 
+                        int option, int covered_item);
 
+/* la file à seaux est testée ici une fois : sans elle, les boucles internes n'en savent rien */
 void cover(const struct instance_t *instance, struct context_t *ctx, int item)
 {
-        if (item_is_primary(instance, item))
+        ctx->covered[item >> 6] |= 1ull << (item & 63);
+        if (item_is_primary(instance, item)) {
                 sparse_array_remove(ctx->active_items, item);
-        struct sparse_array_t *active_options = ctx->active_options[item];
-        for (int i = 0; i < active_options->len; i++) {
-                int option = active_options->p[i];
-                deactivate(instance, ctx, option, item);
+                if (ctx->buckets)
+                        bucket_remove(ctx, item, ctx->active_options[item].len);
+        }
+        struct sparse_array_t *active_options = &ctx->active_options[item];
+        const int *item_options = instance->item_options + instance->item_ptr[item];
+        if (ctx->buckets) {
+                for (int i = 0; i < active_options->len; i++) {
+                        int option = item_options[active_options->p[i]];
+                        deactivate_bucket(instance, ctx, option, item);
+                }
+        } else {
+                for (int i = 0; i < active_options->len; i++) {
+                        int option = item_options[active_options->p[i]];
+                        deactivate(instance, ctx, option, item);
+                }
         }
 }
 
@@ -265,23 +682,51 @@ void deactivate(const struct instance_t *instance, struct context_t *ctx,
                 int item = instance->options[k];
                 if (item == covered_item)
                         continue;
-                sparse_array_remove(ctx->active_options[item], option);
+                sparse_array_remove(&ctx->active_options[item], instance->local_slot[k]);
+        }
+}
+
+/* deactivate, en tenant aussi la file à seaux à jour */
+void deactivate_bucket(const struct instance_t *instance, struct context_t *ctx, 
+                        int option, int covered_item)
+{
+        for (int k = instance->ptr[option]; k < instance->ptr[option+1]; k++) {
+                int item = instance->options[k];
+                if (item == covered_item)
+                        continue;
+                if (item_is_primary(instance, item))
+                        bucket_decrease(ctx, item, ctx->active_options[item].len);
+                sparse_array_remove(&ctx->active_options[item], instance->local_slot[k]);
         }
 }
 
 
 void reactivate(const struct instance_t *instance, struct context_t *ctx, 
                         int option, int uncovered_item);
+void reactivate_bucket(const struct instance_t *instance, struct context_t *ctx, 
+                        int option, int uncovered_item);
 
 void uncover(const struct instance_t *instance, struct context_t *ctx, int item)
 {
-        struct sparse_array_t *active_options = ctx->active_options[item];
-        for (int i = active_options->len - 1; i >= 0; i--) {
-                int option = active_options->p[i];
-                reactivate(instance, ctx, option, item);
+        struct sparse_array_t *active_options = &ctx->active_options[item];
+        const int *item_options = instance->item_options + instance->item_ptr[item];
+        if (ctx->buckets) {
+                for (int i = active_options->len - 1; i >= 0; i--) {
+                        int option = item_options[active_options->p[i]];
+                        reactivate_bucket(instance, ctx, option, item);
+                }
+        } else {
+                for (int i = active_options->len - 1; i >= 0; i--) {
+                        int option = item_options[active_options->p[i]];
+                        reactivate(instance, ctx, option, item);
+                }
         }
-        if (item_is_primary(instance, item))
+        if (item_is_primary(instance, item)) {
+                if (ctx->buckets)
+                        bucket_restore(ctx, item, ctx->active_options[item].len);
                 sparse_array_unremove(ctx->active_items);
+        }
+        ctx->covered[item >> 6] &= ~(1ull << (item & 63));
 }
 
 
@@ -292,249 +737,1472 @@ void reactivate(const struct instance_t *instance, struct context_t *ctx,
                 int item = instance->options[k];
                 if (item == uncovered_item)
                         continue;
-                sparse_array_unremove(ctx->active_options[item]);
+                sparse_array_unremove(&ctx->active_options[item]);
         }
 }
 
-
-struct instance_t * load_matrix(const char *filename)
+/* inverse de deactivate_bucket */
+void reactivate_bucket(const struct instance_t *instance, struct context_t *ctx, 
+                        int option, int uncovered_item)
 {
-        struct instance_t *instance = malloc(sizeof(*instance));
-        if (instance == NULL)
-                err(1, "Impossible d'allouer l'instance");
-        FILE *in = fopen(filename, "r");
-        if (in == NULL)
-                err(1, "Impossible d'ouvrir %s en lecture", filename);
-        int n_it, n_op;
-        if (fscanf(in, "%d %d\n", &n_it, &n_op) != 2)
-                errx(1, "Erreur de lecture de la taille du problème\n");
-        if (n_it == 0 || n_op == 0)
-                errx(1, "Impossible d'avoir 0 objets ou 0 options");
-        instance->n_items = n_it;
-        instance->n_primary = 0;
-        instance->n_options = n_op;
-        instance->item_name = malloc(n_it * sizeof(char *));
-        instance->ptr = malloc((n_op + 1) * sizeof(int));
-        instance->options = malloc(n_it * n_op *sizeof(int));         // surallocation massive
-        if (instance->item_name == NULL || instance->ptr == NULL || instance->options == NULL)
-                err(1, "Impossible d'allouer la mémoire pour stocker la matrice");
-
-
-        enum state_t {START, ID, WHITESPACE, BAR, ENDLINE, ENDFILE};
-        enum state_t state = START;
+        for (int k = instance->ptr[option + 1] - 1; k >= instance->ptr[option]; k--) {
+                int item = instance->options[k];
+                if (item == uncovered_item)
+                        continue;
+                sparse_array_unremove(&ctx->active_options[item]);
+                if (item_is_primary(instance, item))
+                        bucket_increase(ctx, item, ctx->active_options[item].len);
+        }
+}
 
-        char buffer[256];
-        int i = 0;     // prochain octet disponible du buffer
-        int n = 0;     // dernier octet disponible du buffer
 
-        char id[65];
-        id[64] = 0;    // sentinelle à la fin, quoi qu'il arrive
-        int j = 0;     // longueur de l'identifiant en cours de lecture
+/* construit l'index objet -> options (lecture seule, partagé par tous les contextes) */
+void build_item_index(struct instance_t *instance)
+{
+        int n = instance->n_items;
+        int m = instance->n_options;
+        int total = instance->ptr[m];
+        instance->item_ptr = malloc((n + 1) * sizeof(int));
+        instance->item_options = malloc(total * sizeof(int));
+        instance->local_slot = malloc(total * sizeof(int));
+        int *fill = calloc(n, sizeof(int));
+        if (instance->item_ptr == NULL || instance->item_options == NULL 
+                || instance->local_slot == NULL || fill == NULL)
+                err(1, "impossible d'allouer l'index objet -> options");
+        for (int k = 0; k < total; k++)
+                fill[instance->options[k]]++;
+        instance->item_ptr[0] = 0;
+        for (int item = 0; item < n; item++) {
+                instance->item_ptr[item + 1] = instance->item_ptr[item] + fill[item];
+                fill[item] = 0;
+        }
+        for (int option = 0; option < m; option++)
+                for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++) {
+                        int item = instance->options[k];
+                        int r = fill[item]++;
+                        instance->item_options[instance->item_ptr[item] + r] = option;
+                        instance->local_slot[k] = r;
+                }
+        free(fill);
+}
 
-        int current_item = 0;
-        while (state != ENDLINE) {
-                enum state_t prev_state = state;
-                if (i >= n) {
-                        n = fread(buffer, 1, 256, in);
-                        if (n == 0) {
-                                if (feof(in)) {
-                                        state = ENDFILE;
-                                }
-                                if (ferror(in))
-                                        err(1, "erreur lors de la lecture de %s", in_filename);
-                        }
-                        i = 0;
+/* 
+ * Chargement de la matrice.  Le fichier est projeté en mémoire (mmap) quand
+ * c'est possible, et lu d'un bloc sinon (tube, entrée standard...).  Les
+ * lignes sont découpées par memchr et les identifiants par un balayage SSE2
+ * qui cherche le prochain séparateur 16 octets à la fois.  Les noms d'objets
+ * sont recopiés dans une seule zone, et options[] est dimensionné exactement.
+ */
+
+struct text_t {
+        char *data;
+        size_t size;
+        bool mapped;        // data provient de mmap (sinon de malloc)
+};
 
+void text_open(struct text_t *text, const char *filename)
+{
+        int fd = (strcmp(filename, "-") == 0) ? STDIN_FILENO : open(filename, O_RDONLY);
+        if (fd < 0)
+                err(1, "Impossible d'ouvrir %s en lecture", filename);
+        struct stat st;
+        if (fstat(fd, &st) < 0)
+                err(1, "Impossible d'examiner %s", filename);
+        if (S_ISREG(st.st_mode) && st.st_size > 0) {
+                text->size = st.st_size;
+                text->data = mmap(NULL, text->size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (text->data != MAP_FAILED) {
+                        madvise(text->data, text->size, MADV_SEQUENTIAL);
+                        text->mapped = true;
+                        close(fd);
+                        return;
                 }
-                if (state == ENDFILE) {
-                        // don't examine buffer[i]
-                } else if (buffer[i] == '\n') {
-                        state = ENDLINE;
-                } else if (buffer[i] == '|') {
-                        state = BAR;
-                } else if (isspace(buffer[i])) {
-                        state = WHITESPACE;
-                } else {
-                        state = ID;
+        }
+        /* pas de projection possible : on lit tout */
+        size_t capacity = 1 << 16;
+        text->size = 0;
+        text->mapped = false;
+        text->data = malloc(capacity);
+        if (text->data == NULL)
+                err(1, "Impossible d'allouer le tampon de lecture");
+        for (;;) {
+                if (text->size == capacity) {
+                        capacity *= 2;
+                        text->data = realloc(text->data, capacity);
+                        if (text->data == NULL)
+                                err(1, "Impossible d'allouer le tampon de lecture");
                 }
+                ssize_t r = read(fd, text->data + text->size, capacity - text->size);
+                if (r < 0)
+                        err(1, "erreur lors de la lecture de %s", filename);
+                if (r == 0)
+                        break;
+                text->size += r;
+        }
+        if (fd != STDIN_FILENO)
+                close(fd);
+}
 
-                // traite le caractère lu
-                if (state == ID) {
-                        if (j == 64)
-                                errx(1, "nom d'objet trop long : %s", id);
-                        id[j] = buffer[i];
-                        j++;
-                }
-                if (prev_state == ID && state != ID) {
-                        id[j] = '\0';
-                        if (current_item == instance->n_items)
-                                errx(1, "Objet excedentaire : %s", id);
-                        for (int k = 0; k < current_item; k++)
-                                if (strcmp(id, instance->item_name[k]) == 0)
-                                        errx(1, "Nom d'objets dupliqué : %s", id);
-                        instance->item_name[current_item] = malloc(j+1);
-                        strcpy(instance->item_name[current_item], id);
-                        current_item++;
-                        j = 0;
+void text_close(struct text_t *text)
+{
+        if (text->mapped)
+                munmap(text->data, text->size);
+        else
+                free(text->data);
+}
 
+/* tout octet <= ' ' sépare les identifiants, tout comme | */
+static inline bool is_separator(char c)
+{
+        return (unsigned char) c <= ' ' || c == '|';
+}
 
-                }
-                if (state == BAR)
-                        instance->n_primary = current_item;
-                if (state == ENDFILE)
-                        errx(1, "Fin de fichier prématurée");
-                // passe au prochain caractère
-                i++;
+/* renvoie l'adresse du premier séparateur dans [p, end), ou end */
+static const char * scan_identifier(const char *p, const char *end)
+{
+#ifdef __SSE2__
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i bar = _mm_set1_epi8('|');
+        while (end - p >= 16) {
+                __m128i x = _mm_loadu_si128((const __m128i *) p);
+                __m128i blank = _mm_cmpeq_epi8(_mm_min_epu8(x, space), x);     // x <= ' '
+                int mask = _mm_movemask_epi8(_mm_or_si128(blank, _mm_cmpeq_epi8(x, bar)));
+                if (mask != 0)
+                        return p + __builtin_ctz(mask);
+                p += 16;
         }
-        if (current_item != instance->n_items)
-                errx(1, "Incohérence : %d objets attendus mais seulement %d fournis\n", 
-                                instance->n_items, current_item);
-        if (instance->n_primary == 0)
-                instance->n_primary = instance->n_items;
-
-        int current_option = 0;
-        int p = 0;       // pointeur courant dans instance->options
-        instance->ptr[0] = p;
-        bool has_primary = false;
-        while (state != ENDFILE) {
-                enum state_t prev_state = state;
-                if (i >= n) {
-                        n = fread(buffer, 1, 256, in);
-                        if (n == 0) {
-                                if (feof(in)) {
-                                        state = ENDFILE;
-                                }
-                                if (ferror(in))
-                                        err(1, "erreur lors de la lecture de %s", in_filename);
-                        }
-                        i = 0;
+#endif
+        while (p < end && !is_separator(*p))
+                p++;
+        return p;
+}
 
-                }
-                if (state == ENDFILE) {
-                        // don't examine buffer[i]
-                } else if (buffer[i] == '\n') {
-                        state = ENDLINE;
-                } else if (buffer[i] == '|') {
-                        state = BAR;
-                } else if (isspace(buffer[i])) {
-                        state = WHITESPACE;
-                } else {
-                        state = ID;
-                }
+static const char * skip_blanks(const char *p, const char *end)
+{
+        while (p < end && (unsigned char) *p <= ' ')
+                p++;
+        return p;
+}
 
-                // traite le caractère lu
-                if (state == ID) {
-                        if (j == 64)
-                                errx(1, "nom d'objet trop long : %s", id);
-                        id[j] = buffer[i];
-                        j++;
-                }
-                if (prev_state == ID && state != ID) {
-                        id[j] = '\0';
-                        // identifie le numéro de l'objet en question
-                        int item_number = -1;
-                        for (int k = 0; k < instance->n_items; k++)
-                                if (strcmp(id, instance->item_name[k]) == 0) {
-                                        item_number = k;
-                                        break;
-                                }
-                        if (item_number == -1)
-                                errx(1, "Objet %s inconnu dans l'option #%d", id, current_option);
-                        // détecte les objets répétés
-                        for (int k = instance->ptr[current_option]; k < p; k++)
-                                if (item_number == instance->options[k])
-                                        errx(1, "Objet %s répété dans l'option %d\n", 
-                                                        instance->item_name[item_number], current_option);
-                        instance->options[p] = item_number;
-                        p++;
-                        has_primary |= item_is_primary(instance, item_number);
-                        j = 0;
+static const char * read_int(const char *p, const char *end, int *x)
+{
+        p = skip_blanks(p, end);
+        long long v = 0;
+        const char *start = p;
+        while (p < end && *p >= '0' && *p <= '9' && v <= 0x7fffffff) {
+                v = 10 * v + (*p - '0');
+                p++;
+        }
+        if (p == start || v > 0x7fffffff)
+                errx(1, "Erreur de lecture de la taille du problème\n");
+        *x = v;
+        return p;
+}
 
+/* table de hachage nom -> numéro d'objet (adressage ouvert, sondage linéaire) */
+struct name_table_t {
+        unsigned mask;      // taille - 1 (puissance de deux)
+        int *slot;          // numéro d'objet + 1, ou 0 si la case est vide
+};
 
-                }
-                if (state == BAR) {
-                        errx(1, "Trouvé | dans une option.");
-                }
-                if ((state == ENDLINE || state == ENDFILE)) {
-                        // esquive les lignes vides
-                        if (p > instance->ptr[current_option]) {
-                                if (current_option == instance->n_options)
-                                        errx(1, "Option excédentaire");
-                                if (!has_primary)
-                                        errx(1, "Option %d sans objet primaire\n", current_option);
-                                current_option++;
-                                instance->ptr[current_option] = p;
-                                has_primary = false;
+static inline unsigned hash_name(const char *id, int len)
+{
+        unsigned h = 2166136261u;                 // FNV-1a
+        for (int i = 0; i < len; i++) {
+                h ^= (unsigned char) id[i];
+                h *= 16777619u;
+        }
+        return h;
+}
 
+void name_table_init(struct name_table_t *T, int n)
+{
+        unsigned size = 16;
+        while (size < 2 * (unsigned) n)
+                size *= 2;
+        T->mask = size - 1;
+        T->slot = calloc(size, sizeof(int));
+        if (T->slot == NULL)
+                err(1, "Impossible d'allouer la table des noms");
+}
 
-                        }
-                }
-                // passe au prochain caractère
-                i++;
+/* renvoie la case contenant [id, id+len), ou la case vide où l'insérer */
+int * name_table_find(const struct instance_t *instance, const struct name_table_t *T, 
+                        const char *id, int len)
+{
+        unsigned h = hash_name(id, len) & T->mask;
+        while (T->slot[h] != 0) {
+                const char *name = instance->item_name[T->slot[h] - 1];
+                if (strncmp(id, name, len) == 0 && name[len] == '\0')
+                        break;
+                h = (h + 1) & T->mask;
         }
-        if (current_option != instance->n_options)
-                errx(1, "Incohérence : %d options attendues mais seulement %d fournies\n", 
-                                instance->n_options, current_option);
+        return &T->slot[h];
+}
 
+/*
+ * Format binaire compilé (.ecb) : un en-tête suivi des tableaux de l'instance
+ * tels qu'ils sont en mémoire, chacun aligné sur 64 octets (ptr, options, index
+ * objet -> options et, optionnellement, les noms).  Le chargement projette le
+ * fichier et fait pointer l'instance dedans, sans aucune copie : tous les
+ * processus d'un même noeud partagent ainsi le cache de pages.
+ */
+#define ECB_MAGIC "EXCOVBIN"
+#define ECB_VERSION 1
+#define ECB_ENDIAN 0x01020304
+
+enum ecb_section_t {ECB_PTR, ECB_OPTIONS, ECB_ITEM_PTR, ECB_ITEM_OPTIONS, ECB_LOCAL_SLOT, 
+                    ECB_NAME_OFFSETS, ECB_NAMES, ECB_SECTIONS};
+
+struct ecb_header_t {
+        char magic[8];
+        uint32_t version;
+        uint32_t endian;                // détecte un fichier produit sur une autre architecture
+        int32_t n_items;
+        int32_t n_primary;
+        int32_t n_options;
+        int32_t has_names;
+        int64_t n_entries;              // ptr[n_options]
+        int64_t offset[ECB_SECTIONS];   // position de chaque section dans le fichier
+        int64_t size[ECB_SECTIONS];     // taille de chaque section, en octets
+};
 
-        fclose(in);
-        fprintf(stderr, "Lu %d objets (%d principaux) et %d options\n", 
-                instance->n_items, instance->n_primary, instance->n_options);
-        return instance;
+static int64_t align_cache_line(int64_t x)
+{
+        return (x + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
 }
 
+bool ecb_detect(const struct text_t *text)
+{
+        return text->size >= 8 && memcmp(text->data, ECB_MAGIC, 8) == 0;
+}
 
-struct context_t * backtracking_setup(const struct instance_t *instance)
+/*
+ * Les tableaux projetés servent tels quels d'indices : on vérifie une fois,
+ * en O(n_entries), que ptr et item_ptr croissent de 0 à n_entries, que chaque
+ * valeur désigne un objet (ou une option) existant et que local_slot renvoie
+ * bien chaque case de options vers son option.  Comme load_matrix, on refuse
+ * un objet répété dans une option et une option sans objet primaire ; enfin
+ * chaque case de item_options doit être désignée par exactement une entrée,
+ * sans quoi deactivate retirerait deux fois la même case.
+ */
+static void ecb_check_arrays(const struct instance_t *instance, int64_t n_entries, const char *filename)
 {
-        struct context_t *ctx = malloc(sizeof(*ctx));
-        if (ctx == NULL)
-                err(1, "impossible d'allouer un contexte");
-        ctx->level = 0;
-        ctx->nodes = 0;
-        ctx->solutions = 0;
         int n = instance->n_items;
         int m = instance->n_options;
-        ctx->active_options = malloc(n * sizeof(*ctx->active_options));
-        ctx->chosen_options = malloc(n * sizeof(*ctx->chosen_options));
-        ctx->child_num = malloc(n * sizeof(*ctx->child_num));
-        ctx->num_children = malloc(n * sizeof(*ctx->num_children));
-        if (ctx->active_options == NULL || ctx->chosen_options == NULL
-                || ctx->child_num == NULL || ctx->num_children == NULL)
-                err(1, "impossible d'allouer le contexte");
-        ctx->active_items = sparse_array_init(n);
-        for (int item = 0; item < instance->n_primary; item++)
-                sparse_array_add(ctx->active_items, item);
-
+        const int *ptr = instance->ptr;
+        const int *item_ptr = instance->item_ptr;
+        if (ptr[0] != 0 || ptr[m] != n_entries || item_ptr[0] != 0 || item_ptr[n] != n_entries)
+                errx(1, "%s : image binaire incohérente", filename);
         for (int item = 0; item < n; item++)
-                ctx->active_options[item] = sparse_array_init(m);
-        for (int option = 0; option < m; option++)
-                for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++) {
+                if (item_ptr[item + 1] < item_ptr[item] || item_ptr[item + 1] > ptr[m])
+                        errx(1, "%s : image binaire incohérente", filename);
+        for (int k = 0; k < ptr[m]; k++)
+                if (instance->item_options[k] < 0 || instance->item_options[k] >= m)
+                        errx(1, "%s : image binaire incohérente", filename);
+        int *stamp = malloc(n * sizeof(int));                   // stamp[j] = dernière option contenant j
+        uint64_t *seen = calloc((n_entries + 63) / 64, sizeof(uint64_t));       // cases de item_options atteintes
+        if ((stamp == NULL && n > 0) || (seen == NULL && n_entries > 0))
+                err(1, "Impossible d'allouer la mémoire pour vérifier l'image");
+        for (int j = 0; j < n; j++)
+                stamp[j] = -1;
+        for (int option = 0; option < m; option++) {
+                if (ptr[option + 1] < ptr[option] || ptr[option + 1] > ptr[m])
+                        errx(1, "%s : image binaire incohérente", filename);
+                bool has_primary = false;
+                for (int k = ptr[option]; k < ptr[option + 1]; k++) {
                         int item = instance->options[k];
-                        sparse_array_add(ctx->active_options[item], option);
+                        if (item < 0 || item >= n || stamp[item] == option)
+                                errx(1, "%s : image binaire incohérente", filename);
+                        stamp[item] = option;
+                        has_primary |= item_is_primary(instance, item);
+                        int r = instance->local_slot[k];
+                        if (r < 0 || r >= item_ptr[item + 1] - item_ptr[item] 
+                                        || instance->item_options[item_ptr[item] + r] != option)
+                                errx(1, "%s : image binaire incohérente", filename);
+                        int64_t slot = item_ptr[item] + r;
+                        if (seen[slot / 64] & (1ull << (slot % 64)))
+                                errx(1, "%s : image binaire incohérente", filename);
+                        seen[slot / 64] |= 1ull << (slot % 64);
                 }
+                if (!has_primary)
+                        errx(1, "%s : image binaire incohérente (option %d sans objet primaire)", filename, option);
+        }
+        for (int64_t slot = 0; slot < n_entries; slot++)
+                if (!(seen[slot / 64] & (1ull << (slot % 64))))
+                        errx(1, "%s : image binaire incohérente", filename);
+        free(stamp);
+        free(seen);
+}
 
+void ecb_load(struct instance_t *instance, const struct text_t *text, const char *filename)
+{
+        const struct ecb_header_t *h = (const struct ecb_header_t *) text->data;
+        if (text->size < sizeof(*h))
+                errx(1, "%s : image binaire tronquée", filename);
+        if (h->endian != ECB_ENDIAN)
+                errx(1, "%s : image binaire produite sur une machine d'un autre boutisme", filename);
+        if (h->version != ECB_VERSION)
+                errx(1, "%s : version %u du format binaire non supportée", filename, h->version);
+        for (int s = 0; s < ECB_SECTIONS; s++)
+                if (h->offset[s] < 0 || h->size[s] < 0 || (uint64_t) h->offset[s] > text->size
+                                || (uint64_t) h->size[s] > text->size - h->offset[s])
+                        errx(1, "%s : image binaire tronquée", filename);
+        int64_t n_entries = h->n_entries;
+        if (h->n_items < 0 || h->n_primary < 0 || h->n_primary > h->n_items || h->n_options < 0
+                        || n_entries < 0 || n_entries > 0x7fffffff)
+                errx(1, "%s : image binaire incohérente", filename);
+        for (int s = 0; s < ECB_SECTIONS; s++)
+                if (h->offset[s] % sizeof(int) != 0)
+                        errx(1, "%s : image binaire incohérente", filename);
+        if (h->size[ECB_PTR] != (h->n_options + 1) * (int64_t) sizeof(int)
+                        || h->size[ECB_OPTIONS] != n_entries * (int64_t) sizeof(int)
+                        || h->size[ECB_ITEM_PTR] != (h->n_items + 1) * (int64_t) sizeof(int)
+                        || h->size[ECB_ITEM_OPTIONS] != n_entries * (int64_t) sizeof(int)
+                        || h->size[ECB_LOCAL_SLOT] != n_entries * (int64_t) sizeof(int))
+                errx(1, "%s : image binaire incohérente", filename);
+        instance->n_items = h->n_items;
+        instance->n_primary = h->n_primary;
+        instance->n_options = h->n_options;
+        instance->ptr = (int *) (text->data + h->offset[ECB_PTR]);
+        instance->options = (int *) (text->data + h->offset[ECB_OPTIONS]);
+        instance->item_ptr = (int *) (text->data + h->offset[ECB_ITEM_PTR]);
+        instance->item_options = (int *) (text->data + h->offset[ECB_ITEM_OPTIONS]);
+        instance->local_slot = (int *) (text->data + h->offset[ECB_LOCAL_SLOT]);
+        ecb_check_arrays(instance, n_entries, filename);
+        instance->item_name = NULL;
+        instance->name_arena = NULL;
+        if (!h->has_names)
+                return;
+        /* seul le tableau de pointeurs vers les noms est reconstruit */
+        const int *name_offsets = (const int *) (text->data + h->offset[ECB_NAME_OFFSETS]);
+        int64_t names_size = h->size[ECB_NAMES];
+        if (h->size[ECB_NAME_OFFSETS] != h->n_items * (int64_t) sizeof(int)
+                        || (h->n_items > 0 && (names_size == 0 
+                                || text->data[h->offset[ECB_NAMES] + names_size - 1] != '\0')))
+                errx(1, "%s : image binaire incohérente", filename);
+        for (int j = 0; j < h->n_items; j++)
+                if (name_offsets[j] < 0 || name_offsets[j] >= names_size)
+                        errx(1, "%s : image binaire incohérente", filename);
+        instance->name_arena = text->data + h->offset[ECB_NAMES];
+        instance->item_name = malloc(instance->n_items * sizeof(char *));
+        if (instance->item_name == NULL)
+                err(1, "Impossible d'allouer les noms d'objets");
+        for (int j = 0; j < instance->n_items; j++)
+                instance->item_name[j] = instance->name_arena + name_offsets[j];
+}
 
+void ecb_write(const struct instance_t *instance, const char *filename)
+{
+        int n = instance->n_items;
+        int m = instance->n_options;
+        int64_t n_entries = instance->ptr[m];
+        struct ecb_header_t h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, ECB_MAGIC, 8);
+        h.version = ECB_VERSION;
+        h.endian = ECB_ENDIAN;
+        h.n_items = n;
+        h.n_primary = instance->n_primary;
+        h.n_options = m;
+        h.has_names = (instance->item_name != NULL);
+        h.n_entries = n_entries;
+
+        int *name_offsets = NULL;
+        int64_t names_size = 0;
+        if (h.has_names) {
+                name_offsets = malloc(n * sizeof(int));
+                if (name_offsets == NULL)
+                        err(1, "Impossible d'allouer la table des noms");
+                for (int j = 0; j < n; j++) {
+                        name_offsets[j] = instance->item_name[j] - instance->name_arena;
+                        int64_t end = name_offsets[j] + strlen(instance->item_name[j]) + 1;
+                        if (end > names_size)
+                                names_size = end;
+                }
+        }
+        const void *data[ECB_SECTIONS] = {instance->ptr, instance->options, instance->item_ptr,
+                instance->item_options, instance->local_slot, name_offsets, instance->name_arena};
+        h.size[ECB_PTR] = (m + 1) * sizeof(int);
+        h.size[ECB_OPTIONS] = n_entries * sizeof(int);
+        h.size[ECB_ITEM_PTR] = (n + 1) * sizeof(int);
+        h.size[ECB_ITEM_OPTIONS] = n_entries * sizeof(int);
+        h.size[ECB_LOCAL_SLOT] = n_entries * sizeof(int);
+        h.size[ECB_NAME_OFFSETS] = h.has_names ? n * sizeof(int) : 0;
+        h.size[ECB_NAMES] = names_size;
+        int64_t off = align_cache_line(sizeof(h));
+        for (int s = 0; s < ECB_SECTIONS; s++) {
+                h.offset[s] = off;
+                off = align_cache_line(off + h.size[s]);
+        }
 
-        return ctx;
+        FILE *out = fopen(filename, "w");
+        if (out == NULL)
+                err(1, "Impossible d'ouvrir %s en écriture", filename);
+        static const char zeros[CACHE_LINE];
+        if (fwrite(&h, sizeof(h), 1, out) != 1)
+                err(1, "erreur lors de l'écriture de %s", filename);
+        int64_t pos = sizeof(h);
+        for (int s = 0; s < ECB_SECTIONS; s++) {
+                if (fwrite(zeros, 1, h.offset[s] - pos, out) != (size_t) (h.offset[s] - pos))
+                        err(1, "erreur lors de l'écriture de %s", filename);
+                if (h.size[s] > 0 && fwrite(data[s], 1, h.size[s], out) != (size_t) h.size[s])
+                        err(1, "erreur lors de l'écriture de %s", filename);
+                pos = h.offset[s] + h.size[s];
+        }
+        if (fclose(out) != 0)
+                err(1, "erreur lors de l'écriture de %s", filename);
+        free(name_offsets);
 }
 
-void solve(const struct instance_t *instance, struct context_t *ctx)
+struct instance_t * load_matrix(const char *filename)
 {
-        ctx->nodes++;
-        if (ctx->nodes == next_report)
+        struct instance_t *instance = malloc(sizeof(*instance));
+        if (instance == NULL)
+                err(1, "Impossible d'allouer l'instance");
+        instance_set_identity(instance);
+        struct text_t text;
+        text_open(&text, filename);
+        if (ecb_detect(&text)) {
+                ecb_load(instance, &text, filename);       // la projection reste en place
+                fprintf(stderr, "Lu %d objets (%d principaux) et %d options (image binaire)\n", 
+                        instance->n_items, instance->n_primary, instance->n_options);
+                return instance;
+        }
+        const char *cur = text.data;
+        const char *end = text.data + text.size;
+
+        int n_it, n_op;
+        cur = read_int(cur, end, &n_it);
+        cur = read_int(cur, end, &n_op);
+        if (n_it == 0 || n_op == 0)
+                errx(1, "Impossible d'avoir 0 objets ou 0 options");
+        cur = skip_blanks(cur, end);
+        instance->n_items = n_it;
+        instance->n_primary = 0;
+        instance->n_options = n_op;
+
+        /* ligne des objets */
+        const char *eol = memchr(cur, '\n', end - cur);
+        if (eol == NULL)
+                errx(1, "Fin de fichier prématurée");
+        instance->item_name = malloc(n_it * sizeof(char *));
+        instance->name_arena = malloc(eol - cur + 1);
+        instance->ptr = malloc((n_op + 1) * sizeof(int));
+        if (instance->item_name == NULL || instance->name_arena == NULL || instance->ptr == NULL)
+                err(1, "Impossible d'allouer la mémoire pour stocker la matrice");
+        char *name = instance->name_arena;
+        struct name_table_t names;
+        name_table_init(&names, n_it);
+        int current_item = 0;
+        while (true) {
+                cur = skip_blanks(cur, eol);
+                if (cur == eol)
+                        break;
+                if (*cur == '|') {
+                        instance->n_primary = current_item;
+                        cur++;
+                        continue;
+                }
+                const char *id_end = scan_identifier(cur, eol);
+                int len = id_end - cur;
+                if (len > 64)
+                        errx(1, "nom d'objet trop long : %.64s", cur);
+                if (current_item == instance->n_items)
+                        errx(1, "Objet excedentaire : %.*s", len, cur);
+                int *slot = name_table_find(instance, &names, cur, len);
+                if (*slot != 0)
+                        errx(1, "Nom d'objets dupliqué : %.*s", len, cur);
+                memcpy(name, cur, len);
+                name[len] = '\0';
+                instance->item_name[current_item] = name;
+                *slot = current_item + 1;
+                name += len + 1;
+                current_item++;
+                cur = id_end;
+        }
+        if (current_item != instance->n_items)
+                errx(1, "Incohérence : %d objets attendus mais seulement %d fournis\n", 
+                                instance->n_items, current_item);
+        if (instance->n_primary == 0)
+                instance->n_primary = instance->n_items;
+
+        /* options : une par ligne non vide */
+        size_t capacity = 4 * (size_t) n_op;
+        instance->options = malloc(capacity * sizeof(int));
+        if (instance->options == NULL)
+                err(1, "Impossible d'allouer la mémoire pour stocker la matrice");
+        int *stamp = malloc(n_it * sizeof(int));     // stamp[j] = dernière option contenant j
+        if (stamp == NULL)
+                err(1, "Impossible d'allouer la mémoire pour stocker la matrice");
+        for (int j = 0; j < n_it; j++)
+                stamp[j] = -1;
+        int current_option = 0;
+        size_t p = 0;       // pointeur courant dans instance->options
+        instance->ptr[0] = p;
+        cur = eol + 1;
+        while (cur < end) {
+                eol = memchr(cur, '\n', end - cur);
+                if (eol == NULL)
+                        eol = end;
+                bool has_primary = false;
+                while (true) {
+                        cur = skip_blanks(cur, eol);
+                        if (cur == eol)
+                                break;
+                        if (*cur == '|')
+                                errx(1, "Trouvé | dans une option.");
+                        const char *id_end = scan_identifier(cur, eol);
+                        int len = id_end - cur;
+                        // identifie le numéro de l'objet en question
+                        int item_number = *name_table_find(instance, &names, cur, len) - 1;
+                        if (item_number == -1)
+                                errx(1, "Objet %.*s inconnu dans l'option #%d", len, cur, current_option);
+                        // détecte les objets répétés
+                        if (stamp[item_number] == current_option)
+                                errx(1, "Objet %s répété dans l'option %d\n", 
+                                                instance->item_name[item_number], current_option);
+                        stamp[item_number] = current_option;
+                        if (p == capacity) {
+                                capacity *= 2;
+                                instance->options = realloc(instance->options, capacity * sizeof(int));
+                                if (instance->options == NULL)
+                                        err(1, "Impossible d'allouer la mémoire pour stocker la matrice");
+                        }
+                        instance->options[p] = item_number;
+                        p++;
+                        has_primary |= item_is_primary(instance, item_number);
+                        cur = id_end;
+                }
+                // esquive les lignes vides
+                if (p > (size_t) instance->ptr[current_option]) {
+                        if (current_option == instance->n_options)
+                                errx(1, "Option excédentaire");
+                        if (!has_primary)
+                                errx(1, "Option %d sans objet primaire\n", current_option);
+                        if (p > 0x7fffffff)
+                                errx(1, "Trop d'entrées dans la matrice");
+                        current_option++;
+                        instance->ptr[current_option] = p;
+                }
+                cur = eol + 1;
+        }
+        if (current_option != instance->n_options)
+                errx(1, "Incohérence : %d options attendues mais seulement %d fournies\n", 
+                                instance->n_options, current_option);
+        instance->options = realloc(instance->options, p * sizeof(int));       // taille exacte
+        if (instance->options == NULL)
+                err(1, "Impossible d'allouer la mémoire pour stocker la matrice");
+
+        free(stamp);
+        free(names.slot);
+        text_close(&text);
+        build_item_index(instance);
+        fprintf(stderr, "Lu %d objets (%d principaux) et %d options\n", 
+                instance->n_items, instance->n_primary, instance->n_options);
+        return instance;
+}
+
+
+/* 
+ * Construit l'instance dérivée de instance dont l'objet i est item_order[i]
+ * (0 <= i < n_items, objets primaires en tête) et l'option o est
+ * option_order[o] (0 <= o < n_options).  Les objets et options absents de ces
+ * listes sont supprimés.  new_forced (de taille n_new_forced) s'ajoute aux
+ * options imposées de instance et les poids sont multipliés par ceux de weight
+ * (NULL : tous 1).
+ */
+struct instance_t * instance_derive(const struct instance_t *instance, 
+                const int *item_order, int n_items, const int *option_order, int n_options,
+                const int *weight, const int *new_forced, int n_new_forced, long long new_base_weight)
+{
+        int n = instance->n_items;
+        struct instance_t *R = malloc(sizeof(*R));
+        int *item_id = malloc(n * sizeof(int));
+        if (R == NULL || item_id == NULL)
+                err(1, "Impossible d'allouer l'instance dérivée");
+        R->origin = (instance->origin != NULL) ? instance->origin : (struct instance_t *) instance;
+        R->n_items = n_items;
+        R->n_primary = 0;
+        R->n_options = n_options;
+        for (int item = 0; item < n; item++)
+                item_id[item] = -1;
+        for (int i = 0; i < n_items; i++) {
+                item_id[item_order[i]] = i;
+                if (item_is_primary(instance, item_order[i])) {
+                        if (R->n_primary != i)
+                                errx(1, "objets primaires et secondaires mélangés");
+                        R->n_primary++;
+                }
+        }
+        int entries = 0;
+        for (int o = 0; o < n_options; o++)
+                entries += instance->ptr[option_order[o] + 1] - instance->ptr[option_order[o]];
+        R->ptr = malloc((n_options + 1) * sizeof(int));
+        R->options = malloc((entries + 1) * sizeof(int));
+        R->option_origin = malloc((n_options + 1) * sizeof(int));
+        R->option_weight = malloc((n_options + 1) * sizeof(int));
+        R->n_forced = instance->n_forced + n_new_forced;
+        R->forced = malloc((R->n_forced + 1) * sizeof(int));
+        R->item_name = NULL;
+        R->name_arena = instance->name_arena;
+        if (instance->item_name != NULL)
+                R->item_name = malloc((n_items + 1) * sizeof(char *));
+        if (R->ptr == NULL || R->options == NULL || R->option_origin == NULL 
+                        || R->option_weight == NULL || R->forced == NULL
+                        || (instance->item_name != NULL && R->item_name == NULL))
+                err(1, "Impossible d'allouer l'instance dérivée");
+        if (R->item_name != NULL)
+                for (int i = 0; i < n_items; i++)
+                        R->item_name[i] = instance->item_name[item_order[i]];
+        R->ptr[0] = 0;
+        for (int o = 0; o < n_options; o++) {
+                int option = option_order[o];
+                int p = R->ptr[o];
+                for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++) {
+                        int item = instance->options[k];
+                        if (item_id[item] < 0)
+                                errx(1, "option dérivée %d contenant un objet supprimé", option);
+                        R->options[p++] = item_id[item];
+                }
+                R->ptr[o + 1] = p;
+                R->option_origin[o] = original_option(instance, option);
+                int w = (instance->option_weight == NULL) ? 1 : instance->option_weight[option];
+                R->option_weight[o] = w * ((weight == NULL) ? 1 : weight[option]);
+        }
+        for (int i = 0; i < instance->n_forced; i++)
+                R->forced[i] = instance->forced[i];
+        for (int i = 0; i < n_new_forced; i++)
+                R->forced[instance->n_forced + i] = original_option(instance, new_forced[i]);
+        R->base_weight = instance->base_weight * new_base_weight;
+        free(item_id);
+        build_item_index(R);
+        return R;
+}
+
+
+/* état de travail de la réduction */
+struct reduction_t {
+        const struct instance_t *instance;
+        bool *item_alive;
+        bool *option_alive;
+        int *degree;              // nombre d'options vivantes contenant l'objet
+        int *weight;              // multiplicité de chaque option (doublons fusionnés)
+        int stamp;                // numéro du dernier test d'option morte
+        int *in_option;           // in_option[j] == stamp : j est dans l'option testée
+        int *seen;                // seen[o] == stamp : o a déjà été compté
+        int *hits_stamp;          // hits[j] n'est valide que si hits_stamp[j] == stamp
+        int *hits;                // nombre d'options de j qui rencontrent l'option testée
+};
+
+static void reduction_kill(struct reduction_t *R, int option)
+{
+        const struct instance_t *instance = R->instance;
+        R->option_alive[option] = false;
+        for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++)
+                R->degree[instance->options[k]]--;
+}
+
+static int compare_int(const void *a, const void *b)
+{
+        int x = *(const int *) a;
+        int y = *(const int *) b;
+        return (x > y) - (x < y);
+}
+
+/* fusionne les options qui contiennent exactement les mêmes objets ; renvoie leur nombre */
+static int reduction_merge_duplicates(struct reduction_t *R)
+{
+        const struct instance_t *instance = R->instance;
+        int m = instance->n_options;
+        int total = instance->ptr[m];
+        int *sorted = malloc((total + 1) * sizeof(int));
+        unsigned size = 16;
+        while (size < 2 * (unsigned) m)
+                size *= 2;
+        int *table = calloc(size, sizeof(int));          // numéro d'option + 1
+        if (sorted == NULL || table == NULL)
+                err(1, "Impossible d'allouer la table des options");
+        memcpy(sorted, instance->options, total * sizeof(int));
+        int merged = 0;
+        for (int option = 0; option < m; option++) {
+                int a = instance->ptr[option];
+                int len = instance->ptr[option + 1] - a;
+                qsort(sorted + a, len, sizeof(int), compare_int);
+                unsigned h = 2166136261u;
+                for (int k = 0; k < len; k++)
+                        h = (h ^ (unsigned) sorted[a + k]) * 16777619u;
+                h &= size - 1;
+                while (table[h] != 0) {
+                        int other = table[h] - 1;
+                        int b = instance->ptr[other];
+                        if (instance->ptr[other + 1] - b == len 
+                                        && memcmp(sorted + a, sorted + b, len * sizeof(int)) == 0)
+                                break;
+                        h = (h + 1) & (size - 1);
+                }
+                if (table[h] == 0) {
+                        table[h] = option + 1;
+                } else {
+                        R->weight[table[h] - 1] += R->weight[option];
+                        reduction_kill(R, option);
+                        merged++;
+                }
+        }
+        free(table);
+        free(sorted);
+        return merged;
+}
+
+/* 
+ * Une option est morte si, une fois choisie, un objet primaire j qu'elle ne
+ * contient pas n'a plus aucune option compatible : toutes les options de j la
+ * rencontrent.  Il suffit d'examiner les objets j voisins de l'option.
+ */
+static bool reduction_option_is_dead(struct reduction_t *R, int option)
+{
+        const struct instance_t *instance = R->instance;
+        int stamp = ++R->stamp;
+        int *in_option = R->in_option;
+        int *seen = R->seen;
+        int *hits = R->hits;
+        int *hits_stamp = R->hits_stamp;
+        for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++)
+                in_option[instance->options[k]] = stamp;
+        for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++) {
+                int item = instance->options[k];
+                for (int l = instance->item_ptr[item]; l < instance->item_ptr[item + 1]; l++) {
+                        int other = instance->item_options[l];
+                        if (!R->option_alive[other] || other == option || seen[other] == stamp)
+                                continue;
+                        seen[other] = stamp;
+                        for (int kk = instance->ptr[other]; kk < instance->ptr[other + 1]; kk++) {
+                                int j = instance->options[kk];
+                                if (in_option[j] == stamp || !item_is_primary(instance, j))
+                                        continue;
+                                if (hits_stamp[j] != stamp) {
+                                        hits_stamp[j] = stamp;
+                                        hits[j] = 0;
+                                }
+                                if (++hits[j] == R->degree[j])
+                                        return true;
+                        }
+                }
+        }
+        return false;
+}
+
+#define REDUCE_BUDGET 400000000LL       // au-delà, pas de recherche d'options mortes
+
+/*
+ * Simplifie l'instance sans changer le nombre de solutions : fusionne les
+ * options identiques, supprime les options mortes, impose l'option unique des
+ * objets primaires de degré 1 et propage.  Un objet primaire sans option rend
+ * l'instance insatisfiable ; on le laisse alors seul, sans option.
+ */
+struct instance_t * reduce_instance(const struct instance_t *instance)
+{
+        int n = instance->n_items;
+        int m = instance->n_options;
+        struct reduction_t R;
+        R.instance = instance;
+        R.item_alive = malloc(n * sizeof(bool));
+        R.option_alive = malloc(m * sizeof(bool));
+        R.degree = malloc(n * sizeof(int));
+        R.weight = malloc(m * sizeof(int));
+        R.stamp = 0;
+        R.in_option = malloc(n * sizeof(int));
+        R.hits = malloc(n * sizeof(int));
+        R.hits_stamp = malloc(n * sizeof(int));
+        R.seen = malloc(m * sizeof(int));
+        int *forced = malloc(n * sizeof(int));
+        if (R.item_alive == NULL || R.option_alive == NULL || R.degree == NULL || R.weight == NULL 
+                        || forced == NULL || R.in_option == NULL || R.hits == NULL 
+                        || R.hits_stamp == NULL || R.seen == NULL)
+                err(1, "Impossible d'allouer la réduction");
+        long long work = 0;
+        for (int item = 0; item < n; item++) {
+                R.item_alive[item] = true;
+                R.degree[item] = instance->item_ptr[item + 1] - instance->item_ptr[item];
+                R.in_option[item] = 0;
+                R.hits_stamp[item] = 0;
+                long long size = 0;
+                for (int l = instance->item_ptr[item]; l < instance->item_ptr[item + 1]; l++) {
+                        int option = instance->item_options[l];
+                        size += instance->ptr[option + 1] - instance->ptr[option];
+                }
+                work += R.degree[item] * size;
+        }
+        for (int option = 0; option < m; option++) {
+                R.option_alive[option] = true;
+                R.weight[option] = 1;
+                R.seen[option] = 0;
+        }
+
+        int duplicates = reduction_merge_duplicates(&R);
+        int dead = 0;
+        int n_forced = 0;
+        long long base_weight = 1;
+        int unsatisfiable = -1;
+        bool look_for_dead = (work <= REDUCE_BUDGET);
+        bool changed = true;
+        while (changed && unsatisfiable < 0) {
+                changed = false;
+                for (int item = 0; item < instance->n_primary && unsatisfiable < 0; item++) {
+                        if (!R.item_alive[item] || R.degree[item] > 1)
+                                continue;
+                        if (R.degree[item] == 0) {
+                                unsatisfiable = item;
+                                break;
+                        }
+                        /* option imposée : on la choisit et on retire tout ce qu'elle rencontre */
+                        int choice = -1;
+                        for (int l = instance->item_ptr[item]; l < instance->item_ptr[item + 1]; l++)
+                                if (R.option_alive[instance->item_options[l]])
+                                        choice = instance->item_options[l];
+                        forced[n_forced++] = choice;
+                        base_weight *= R.weight[choice];
+                        for (int k = instance->ptr[choice]; k < instance->ptr[choice + 1]; k++) {
+                                int covered = instance->options[k];
+                                R.item_alive[covered] = false;
+                                for (int l = instance->item_ptr[covered]; l < instance->item_ptr[covered + 1]; l++)
+                                        if (R.option_alive[instance->item_options[l]])
+                                                reduction_kill(&R, instance->item_options[l]);
+                        }
+                        changed = true;
+                }
+                if (!look_for_dead || unsatisfiable >= 0)
+                        continue;
+                for (int option = 0; option < m; option++)
+                        if (R.option_alive[option] 
+                                && reduction_option_is_dead(&R, option)) {
+                                reduction_kill(&R, option);
+                                dead++;
+                                changed = true;
+                        }
+        }
+        if (unsatisfiable >= 0) {
+                /* ne garde que l'objet fautif : la recherche échoue immédiatement */
+                for (int item = 0; item < n; item++)
+                        R.item_alive[item] = (item == unsatisfiable);
+                for (int option = 0; option < m; option++)
+                        R.option_alive[option] = false;
+        }
+        /* les survivants gardent leur ordre (donc les primaires restent en tête) */
+        int *item_order = malloc(n * sizeof(int));
+        int *option_order = malloc(m * sizeof(int));
+        if (item_order == NULL || option_order == NULL)
+                err(1, "Impossible d'allouer la réduction");
+        int n_items = 0;
+        int n_options = 0;
+        for (int item = 0; item < n; item++)
+                if (R.item_alive[item])
+                        item_order[n_items++] = item;
+        for (int option = 0; option < m; option++)
+                if (R.option_alive[option])
+                        option_order[n_options++] = option;
+        struct instance_t *reduced = instance_derive(instance, item_order, n_items, option_order, 
+                                        n_options, R.weight, forced, n_forced, base_weight);
+        free(item_order);
+        free(option_order);
+        fprintf(stderr, "Réduction : %d -> %d objets, %d -> %d options "
+                        "(%d doublons, %d options mortes, %d options imposées)\n",
+                        n, reduced->n_items, m, reduced->n_options, duplicates, dead, n_forced);
+        if (!look_for_dead)
+                fprintf(stderr, "Réduction : instance trop dense, options mortes non recherchées\n");
+        if (unsatisfiable >= 0)
+                fprintf(stderr, "Réduction : l'objet primaire %d n'a plus aucune option, instance insatisfiable\n", 
+                                unsatisfiable);
+        free(R.item_alive);
+        free(R.option_alive);
+        free(R.degree);
+        free(R.weight);
+        free(forced);
+        free(R.in_option);
+        free(R.hits);
+        free(R.hits_stamp);
+        free(R.seen);
+        return reduced;
+}
+
+
+static int compare_long_long(const void *a, const void *b)
+{
+        long long x = *(const long long *) a;
+        long long y = *(const long long *) b;
+        return (x > y) - (x < y);
+}
+
+/* écart moyen entre le plus petit et le plus grand numéro d'objet d'une option */
+static double mean_option_span(const struct instance_t *instance)
+{
+        long long total = 0;
+        for (int option = 0; option < instance->n_options; option++) {
+                int lo = instance->n_items;
+                int hi = -1;
+                for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++) {
+                        int item = instance->options[k];
+                        lo = (item < lo) ? item : lo;
+                        hi = (item > hi) ? item : hi;
+                }
+                total += hi - lo;
+        }
+        return (instance->n_options > 0) ? (double) total / instance->n_options : 0.0;
+}
+
+/*
+ * Renumérotation (--renumber) : ordre de Cuthill-McKee inversé sur le graphe
+ * biparti objets-options.  Un parcours en largeur part d'un objet de degré
+ * minimal et visite les voisins par degré croissant ; les objets et les
+ * options sont numérotés dans l'ordre inverse de leur découverte.  Les options
+ * qui se rencontrent reçoivent ainsi des numéros proches, tout comme les objets
+ * d'une même option.  Les objets primaires restent en tête.
+ */
+struct instance_t * renumber_instance(const struct instance_t *instance)
+{
+        int n = instance->n_items;
+        int m = instance->n_options;
+        int *item_order = malloc(n * sizeof(int));
+        int *option_order = malloc(m * sizeof(int));
+        int *queue = malloc(n * sizeof(int));
+        bool *item_seen = calloc(n, sizeof(bool));
+        bool *option_seen = calloc(m, sizeof(bool));
+        int max_degree = 1;
+        for (int item = 0; item < n; item++) {
+                int degree = instance->item_ptr[item + 1] - instance->item_ptr[item];
+                max_degree = (degree > max_degree) ? degree : max_degree;
+        }
+        int max_len = 1;
+        for (int option = 0; option < m; option++) {
+                int len = instance->ptr[option + 1] - instance->ptr[option];
+                max_len = (len > max_len) ? len : max_len;
+        }
+        long long *neighbours = malloc(((max_degree > max_len) ? max_degree : max_len) * sizeof(long long));
+        if (item_order == NULL || option_order == NULL || queue == NULL || item_seen == NULL 
+                        || option_seen == NULL || neighbours == NULL)
+                err(1, "Impossible d'allouer la renumérotation");
+
+        int n_queued = 0;       // objets découverts
+        int head = 0;
+        int n_options = 0;      // options découvertes
+        while (n_queued < n) {
+                /* nouvelle composante : part d'un objet non visité de degré minimal */
+                int root = -1;
+                int root_degree = 0x7fffffff;
+                for (int item = 0; item < n; item++) {
+                        int degree = instance->item_ptr[item + 1] - instance->item_ptr[item];
+                        if (!item_seen[item] && degree < root_degree) {
+                                root = item;
+                                root_degree = degree;
+                        }
+                }
+                item_seen[root] = true;
+                queue[n_queued++] = root;
+                while (head < n_queued) {
+                        int item = queue[head++];
+                        /* options de l'objet, des plus courtes aux plus longues */
+                        int k = 0;
+                        for (int l = instance->item_ptr[item]; l < instance->item_ptr[item + 1]; l++) {
+                                int option = instance->item_options[l];
+                                if (option_seen[option])
+                                        continue;
+                                option_seen[option] = true;
+                                long long len = instance->ptr[option + 1] - instance->ptr[option];
+                                neighbours[k++] = (len << 32) | option;
+                        }
+                        qsort(neighbours, k, sizeof(long long), compare_long_long);
+                        int first = n_options;
+                        for (int i = 0; i < k; i++)
+                                option_order[n_options++] = neighbours[i] & 0xffffffff;
+                        /* puis leurs objets, par degré croissant */
+                        for (int o = first; o < n_options; o++) {
+                                int option = option_order[o];
+                                int kk = 0;
+                                for (int p = instance->ptr[option]; p < instance->ptr[option + 1]; p++) {
+                                        int other = instance->options[p];
+                                        if (item_seen[other])
+                                                continue;
+                                        item_seen[other] = true;
+                                        long long degree = instance->item_ptr[other + 1] - instance->item_ptr[other];
+                                        neighbours[kk++] = (degree << 32) | other;
+                                }
+                                qsort(neighbours, kk, sizeof(long long), compare_long_long);
+                                for (int i = 0; i < kk; i++)
+                                        queue[n_queued++] = neighbours[i] & 0xffffffff;
+                        }
+                }
+        }
+        if (n_options != m)
+                errx(1, "renumérotation : %d options atteintes sur %d", n_options, m);
+
+        /* ordre inverse, primaires d'abord */
+        int i = 0;
+        for (int pass = 0; pass < 2; pass++)
+                for (int j = n - 1; j >= 0; j--)
+                        if (item_is_primary(instance, queue[j]) == (pass == 0))
+                                item_order[i++] = queue[j];
+        for (int o = 0; o < m / 2; o++) {
+                int tmp = option_order[o];
+                option_order[o] = option_order[m - 1 - o];
+                option_order[m - 1 - o] = tmp;
+        }
+        struct instance_t *renumbered = instance_derive(instance, item_order, n, option_order, m, 
+                                                NULL, NULL, 0, 1);
+        fprintf(stderr, "Renumérotation : écart moyen des objets d'une option %.1f -> %.1f\n", 
+                        mean_option_span(instance), mean_option_span(renumbered));
+        free(item_order);
+        free(option_order);
+        free(queue);
+        free(item_seen);
+        free(option_seen);
+        free(neighbours);
+        return renumbered;
+}
+
+
+/* nombre d'entiers réservés pour un tableau creux de capacité n (p et q), arrondi à la ligne de cache */
+static size_t sparse_array_footprint(int n)
+{
+        size_t ints_per_line = CACHE_LINE / sizeof(int);
+        return ((2 * (size_t) n + ints_per_line - 1) / ints_per_line) * ints_per_line;
+}
+
+/*
+ * Découpe l'arène de ctx.  Si base est NULL, se contente de calculer sa taille ;
+ * sinon fait pointer tous les tableaux du contexte dans base.  Ne touche pas au
+ * contenu : après un memcpy d'arène, il suffit de rappeler context_layout.
+ */
+size_t context_layout(const struct instance_t *instance, struct context_t *ctx, char *base)
+{
+        int n = instance->n_items;
+        size_t off = 0;
+        size_t headers = n * sizeof(struct sparse_array_t) + sizeof(struct sparse_array_t);
+        headers = (headers + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        if (base != NULL) {
+                ctx->active_options = (struct sparse_array_t *) base;
+                ctx->active_items = ctx->active_options + n;
+        }
+        off += headers;
+        size_t stack = 4 * (size_t) n * sizeof(int);
+        stack = (stack + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        if (base != NULL) {
+                int *t = (int *) (base + off);
+                ctx->chosen_options = t;
+                ctx->child_num = t + n;
+                ctx->num_children = t + 2 * n;
+                ctx->failures = t + 3 * n;
+        }
+        off += stack;
+        int max_degree = 0;
+        for (int item = 0; item < instance->n_primary; item++) {
+                int degree = instance->item_ptr[item + 1] - instance->item_ptr[item];
+                max_degree = (degree > max_degree) ? degree : max_degree;
+        }
+        size_t queue = (2 * (size_t) instance->n_primary + max_degree + 2) * sizeof(int);
+        queue = (queue + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        if (base != NULL) {
+                int *t = (int *) (base + off);
+                ctx->by_count = t;
+                ctx->by_count_pos = t + instance->n_primary;
+                ctx->bucket_start = t + 2 * instance->n_primary;
+        }
+        off += queue;
+        size_t words = ((size_t) n + 63) / 64 * sizeof(uint64_t);
+        words = (words + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        if (base != NULL)
+                ctx->covered = (uint64_t *) (base + off);
+        off += words;
+        if (base != NULL)
+                sparse_array_bind(ctx->active_items, (int *) (base + off), n);
+        off += sparse_array_footprint(n) * sizeof(int);
+        for (int item = 0; item < n; item++) {
+                int degree = instance->item_ptr[item + 1] - instance->item_ptr[item];
+                if (base != NULL)
+                        sparse_array_bind(&ctx->active_options[item], (int *) (base + off), degree);
+                off += sparse_array_footprint(degree) * sizeof(int);
+        }
+        return off;
+}
+
+struct context_t * backtracking_setup(const struct instance_t *instance)
+{
+        struct context_t *ctx = malloc(sizeof(*ctx));
+        if (ctx == NULL)
+                err(1, "impossible d'allouer un contexte");
+        ctx->level = 0;
+        ctx->nodes = 0;
+        ctx->solutions = 0;
+        ctx->tail = NULL;
+        ctx->memo = NULL;
+        ctx->split = NULL;
+        int n = instance->n_items;
+        ctx->arena_size = context_layout(instance, ctx, NULL);
+        ctx->arena = aligned_alloc(CACHE_LINE, ctx->arena_size);
+        if (ctx->arena == NULL)
+                err(1, "impossible d'allouer le contexte");
+        context_layout(instance, ctx, ctx->arena);
+        for (int w = 0; w < (n + 63) / 64; w++)
+                ctx->covered[w] = 0;
+        sparse_array_clear(ctx->active_items);
+        for (int item = 0; item < instance->n_primary; item++)
+                sparse_array_add(ctx->active_items, item);
+        for (int item = 0; item < n; item++)
+                ctx->failures[item] = 1;
+        ctx->rng = seed * 0x9e3779b97f4a7c15ull + 1;
+
+        for (int item = 0; item < n; item++) {
+                struct sparse_array_t *active_options = &ctx->active_options[item];
+                sparse_array_clear(active_options);
+                for (int r = 0; r < active_options->capacity; r++)
+                        sparse_array_add(active_options, r);
+        }
+
+        /* file à seaux : tri par dénombrement des objets primaires selon leur degré */
+        int n_primary = instance->n_primary;
+        ctx->buckets = buckets_pay_off(instance);
+        int max_degree = 0;
+        for (int item = 0; item < n_primary; item++)
+                max_degree = (ctx->active_options[item].len > max_degree) ? ctx->active_options[item].len : max_degree;
+        int *fill = ctx->bucket_start;
+        for (int b = 0; b <= max_degree + 1; b++)
+                fill[b] = 0;
+        for (int item = 0; item < n_primary; item++)
+                fill[ctx->active_options[item].len + 1]++;
+        int pos = 0;
+        for (int b = 0; b <= max_degree + 1; b++) {
+                int size = fill[b];
+                fill[b] = pos;
+                pos += size;
+        }
+        for (int item = 0; item < n_primary; item++) {
+                int j = fill[ctx->active_options[item].len + 1]++;
+                ctx->by_count[j] = item;
+                ctx->by_count_pos[item] = j;
+        }
+        for (int b = max_degree + 1; b >= 1; b--)
+                fill[b] = fill[b - 1];
+        fill[0] = 0;
+        return ctx;
+}
+
+/*
+ * Mémoïsation du comptage (--count-memo).  Le sous-arbre d'un noeud ne dépend
+ * que de l'ensemble des objets déjà couverts : une option est encore active
+ * si et seulement si elle n'en contient aucun.  La table associe à cet
+ * ensemble (clé de words mots, comparée en entier) le nombre pondéré de
+ * solutions du sous-arbre.  Sa taille est bornée (MEMO_BYTES) ; chaque case
+ * a deux places, l'une gardant le sous-arbre le plus coûteux (en noeuds),
+ * l'autre remplacée à chaque fois.
+ */
+#define MEMO_BYTES (256ll << 20)
+
+struct memo_t {
+        int words;                // mots de 64 bits par clé
+        size_t mask;              // nombre de cases - 1 (puissance de 2)
+        uint64_t *keys;           // 2 places par case, words mots par place
+        long long *count;         // solutions du sous-arbre (-1 : place libre)
+        long long *work;          // noeuds explorés pour les compter
+        long long hits;
+        long long stores;
+};
+
+struct memo_t * memo_setup(int words)
+{
+        struct memo_t *M = malloc(sizeof(*M));
+        if (M == NULL)
+                err(1, "impossible d'allouer la table de mémoïsation");
+        size_t slot = words * sizeof(uint64_t) + 2 * sizeof(long long);
+        size_t n_slots = 2;
+        while (2 * n_slots * slot <= MEMO_BYTES)
+                n_slots *= 2;
+        M->words = words;
+        M->mask = n_slots / 2 - 1;
+        M->keys = malloc(n_slots * words * sizeof(uint64_t));
+        M->count = malloc(n_slots * sizeof(long long));
+        M->work = malloc(n_slots * sizeof(long long));
+        if (M->keys == NULL || M->count == NULL || M->work == NULL)
+                err(1, "impossible d'allouer la table de mémoïsation");
+        for (size_t i = 0; i < n_slots; i++)
+                M->count[i] = -1;
+        M->hits = 0;
+        M->stores = 0;
+        return M;
+}
+
+static inline size_t memo_hash(const struct memo_t *M, const uint64_t *key)
+{
+        uint64_t h = 0;
+        for (int w = 0; w < M->words; w++)
+                h = (h ^ key[w]) * 0x9e3779b97f4a7c15ull;
+        h ^= h >> 32;
+        return h & M->mask;
+}
+
+static inline bool memo_key_equal(const struct memo_t *M, size_t slot, const uint64_t *key)
+{
+        const uint64_t *k = M->keys + slot * M->words;
+        for (int w = 0; w < M->words; w++)
+                if (k[w] != key[w])
+                        return false;
+        return true;
+}
+
+/* renvoie le nombre de solutions mémorisé pour key, ou -1 */
+long long memo_lookup(struct memo_t *M, const uint64_t *key)
+{
+        size_t slot = 2 * memo_hash(M, key);
+        for (size_t i = slot; i < slot + 2; i++)
+                if (M->count[i] >= 0 && memo_key_equal(M, i, key)) {
+                        M->hits++;
+                        return M->count[i];
+                }
+        return -1;
+}
+
+void memo_store(struct memo_t *M, const uint64_t *key, long long count, long long work)
+{
+        size_t slot = 2 * memo_hash(M, key);
+        if (M->count[slot] >= 0 && work < M->work[slot])
+                slot++;                 /* la première place garde le sous-arbre le plus coûteux */
+        memcpy(M->keys + slot * M->words, key, M->words * sizeof(uint64_t));
+        M->count[slot] = count;
+        M->work[slot] = work;
+        M->stores++;
+}
+
+/*
+ * Décomposition en composantes indépendantes (--components K, comptage
+ * seulement).  Tous les K niveaux, un parcours en largeur relie les objets
+ * actifs par les options actives (les objets secondaires servant de relais).
+ * Si les objets primaires actifs forment plusieurs composantes, aucune option
+ * n'en touche deux : le nombre de solutions est le produit de ceux des
+ * composantes.  Chacune est comptée par solve après avoir masqué les objets
+ * primaires des autres (retirés de active_items et marqués couverts dans la
+ * clé de --count-memo, ce qui décrit exactement le sous-problème restant).
+ */
+struct split_t {
+        int every;                // niveaux entre deux recherches de composantes
+        int guard;                // niveau déjà décomposé (pas de nouvelle recherche)
+        int stamp;                // marque du parcours courant
+        int *mark;                // mark[i] == stamp : objet i déjà atteint
+        int *option_mark;         // idem pour les options
+        int *queue;
+        int *scratch;             // pile des order/first des décompositions en cours (imbriquées)
+        size_t scratch_size;      // taille de scratch, en entiers
+        size_t scratch_top;       // entiers utilisés par les décompositions en cours
+        long long splits;         // nombre de décompositions effectuées
+};
+
+struct split_t * split_setup(const struct instance_t *instance, int every)
+{
+        struct split_t *S = malloc(sizeof(*S));
+        if (S == NULL)
+                err(1, "impossible d'allouer la décomposition en composantes");
+        S->every = every;
+        S->guard = -1;
+        S->stamp = 0;
+        S->mark = calloc(instance->n_items, sizeof(int));
+        S->option_mark = calloc(instance->n_options, sizeof(int));
+        S->queue = malloc(instance->n_items * sizeof(int));
+        S->scratch_size = 2 * (size_t) instance->n_primary + 1;     // de quoi décomposer la racine
+        S->scratch_top = 0;
+        S->scratch = malloc(S->scratch_size * sizeof(int));
+        if (S->mark == NULL || S->option_mark == NULL || S->queue == NULL || S->scratch == NULL)
+                err(1, "impossible d'allouer la décomposition en composantes");
+        S->splits = 0;
+        return S;
+}
+
+/* retire temporairement un objet primaire actif (inverse : unhide_item, dans l'ordre inverse) */
+static void hide_item(struct context_t *ctx, int item)
+{
+        sparse_array_remove(ctx->active_items, item);
+        if (ctx->buckets)
+                bucket_remove(ctx, item, ctx->active_options[item].len);
+        ctx->covered[item >> 6] |= 1ull << (item & 63);
+}
+
+static void unhide_item(struct context_t *ctx, int item)
+{
+        ctx->covered[item >> 6] &= ~(1ull << (item & 63));
+        if (ctx->buckets)
+                bucket_restore(ctx, item, ctx->active_options[item].len);
+        sparse_array_unremove(ctx->active_items);
+}
+
+void solve(const struct instance_t *instance, struct context_t *ctx);
+
+/*
+ * Compte le noeud courant composante par composante ; renvoie false s'il n'y
+ * en a qu'une.  order (objets primaires groupés par composante) et first sont
+ * pris au sommet de S->scratch : une décomposition imbriquée, lancée par solve
+ * sur une composante, s'empile au-dessus (et peut déplacer scratch).
+ */
+bool solve_split(const struct instance_t *instance, struct context_t *ctx)
+{
+        struct split_t *S = ctx->split;
+        if (ctx->level % S->every != 0 || ctx->level == S->guard)
+                return false;
+        const struct sparse_array_t *active_items = ctx->active_items;
+        int n_active = active_items->len;
+        size_t base = S->scratch_top;
+        size_t need = 2 * (size_t) n_active + 1;
+        if (base + need > S->scratch_size) {
+                S->scratch_size = (2 * S->scratch_size > base + need) ? 2 * S->scratch_size : base + need;
+                S->scratch = realloc(S->scratch, S->scratch_size * sizeof(int));
+                if (S->scratch == NULL)
+                        err(1, "impossible d'allouer les composantes");
+        }
+        int *order = S->scratch + base;
+        int *first = order + n_active;
+        S->stamp++;
+        int n_components = 0;
+        int n_order = 0;
+        for (int i = 0; i < n_active; i++) {
+                int seed = active_items->p[i];
+                if (S->mark[seed] == S->stamp)
+                        continue;
+                first[n_components++] = n_order;
+                S->mark[seed] = S->stamp;
+                int head = 0;
+                int tail = 0;
+                S->queue[tail++] = seed;
+                while (head < tail) {
+                        int item = S->queue[head++];
+                        if (item_is_primary(instance, item))
+                                order[n_order++] = item;
+                        const struct sparse_array_t *active_options = &ctx->active_options[item];
+                        for (int j = 0; j < active_options->len; j++) {
+                                int option = item_option(instance, item, active_options->p[j]);
+                                if (S->option_mark[option] == S->stamp)
+                                        continue;
+                                S->option_mark[option] = S->stamp;
+                                for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++) {
+                                        int other = instance->options[k];
+                                        if (S->mark[other] != S->stamp) {
+                                                S->mark[other] = S->stamp;
+                                                S->queue[tail++] = other;
+                                        }
+                                }
+                        }
+                }
+        }
+        first[n_components] = n_order;
+        if (n_components == 1)
+                return false;
+
+        S->splits++;
+        int saved_guard = S->guard;
+        S->guard = ctx->level;
+        long long weight = solution_weight(instance, ctx);
+        long long solutions = ctx->solutions;
+        long long product = 1;
+        S->scratch_top = base + need;
+        for (int c = 0; c < n_components && product != 0; c++) {
+                for (int i = 0; i < n_order; i++)
+                        if (i < first[c] || i >= first[c + 1])
+                                hide_item(ctx, order[i]);
+                solve(instance, ctx);
+                order = S->scratch + base;
+                first = order + n_active;
+                for (int i = n_order - 1; i >= 0; i--)
+                        if (i < first[c] || i >= first[c + 1])
+                                unhide_item(ctx, order[i]);
+                product *= (ctx->solutions - solutions) / weight;
+                ctx->solutions = solutions;
+        }
+        ctx->solutions = solutions + weight * product;
+        S->guard = saved_guard;
+        S->scratch_top = base;
+        return true;
+}
+
+bool solve_tail(const struct instance_t *instance, struct context_t *ctx);
+
+/*
+ * Coups forcés (sauf --no-propagate) : tant qu'un objet primaire n'a plus
+ * qu'une option active, celle-ci est choisie sur place, sans appel récursif
+ * ni noeud.  Les options ainsi choisies s'empilent dans chosen_options (avec
+ * num_children = 1), ce qui sert de journal pour les défaire d'un bloc.  Les
+ * heuristiques font passer en premier un objet primaire vidé, donc un échec
+ * se voit sur l'objet choisi dès que l'option forcée est posée, sans
+ * compteur à tenir dans cover/uncover.  Renvoie l'objet sur lequel brancher
+ * (au moins deux options), -1 s'il n'y a plus d'objet actif, ou -2 en cas
+ * d'échec.
+ */
+int propagate_forced(const struct instance_t *instance, struct context_t *ctx)
+{
+        for (;;) {
+                if (sparse_array_empty(ctx->active_items))
+                        return -1;
+                int item = choose_next_item(instance, ctx);
+                if (!propagate)
+                        return item;
+                if (ctx->active_options[item].len == 0)
+                        return -2;
+                if (ctx->active_options[item].len != 1)
+                        return item;
+                int option = item_option(instance, item, ctx->active_options[item].p[0]);
+                ctx->num_children[ctx->level] = 1;
+                ctx->child_num[ctx->level] = 0;
+                choose_option(instance, ctx, option, -1);
+        }
+}
+
+/* défait les coups forcés posés au-dessus du niveau level */
+void unpropagate_forced(const struct instance_t *instance, struct context_t *ctx, int level)
+{
+        while (ctx->level > level)
+                unchoose_option(instance, ctx, ctx->chosen_options[ctx->level - 1], -1);
+}
+
+void solve(const struct instance_t *instance, struct context_t *ctx)
+{
+        if (ctx->tail != NULL && solve_tail(instance, ctx))
+                return;                         /* sous-arbre terminé par le moteur bitset */
+        ctx->nodes++;
+        if (ctx->nodes == next_report)
                 progress_report(ctx);
-        if (sparse_array_empty(ctx->active_items)) {
+        int level = ctx->level;
+        int chosen_item = propagate_forced(instance, ctx);
+        if (chosen_item == -2) {
+                branching_failure(ctx);
+                unpropagate_forced(instance, ctx, level);
+                return;                         /* échec : un objet primaire n'a plus d'option */
+        }
+        if (chosen_item == -1) {
                 solution_found(instance, ctx);
+                unpropagate_forced(instance, ctx, level);
                 return;                         /* succès : plus d'objet actif */
         }
-        int chosen_item = choose_next_item(ctx);
-        struct sparse_array_t *active_options = ctx->active_options[chosen_item];
-        if (sparse_array_empty(active_options))
-                return;           /* échec : impossible de couvrir chosen_item */
+        long long weight = 0;
+        long long solutions = ctx->solutions;
+        long long nodes = ctx->nodes;
+        if (ctx->memo != NULL) {
+                weight = solution_weight(instance, ctx);
+                long long count = memo_lookup(ctx->memo, ctx->covered);
+                if (count >= 0) {
+                        ctx->solutions += weight * count;
+                        unpropagate_forced(instance, ctx, level);
+                        return;                 /* sous-problème déjà compté */
+                }
+        }
+        struct sparse_array_t *active_options = &ctx->active_options[chosen_item];
+        if (sparse_array_empty(active_options)) {
+                branching_failure(ctx);
+                return;           /* échec : impossible de couvrir chosen_item (--no-propagate) */
+        }
+        if (ctx->split != NULL && active_options->len > 1 && solve_split(instance, ctx)) {
+                if (ctx->memo != NULL)
+                        memo_store(ctx->memo, ctx->covered, (ctx->solutions - solutions) / weight,
+                                        ctx->nodes - nodes);
+                unpropagate_forced(instance, ctx, level);
+                return;                         /* produit des composantes */
+        }
         cover(instance, ctx, chosen_item);
         ctx->num_children[ctx->level] = active_options->len;
         for (int k = 0; k < active_options->len; k++) {
-                int option = active_options->p[k];
+                int option = item_option(instance, chosen_item, active_options->p[k]);
                 ctx->child_num[ctx->level] = k;
                 choose_option(instance, ctx, option, chosen_item);
                 solve(instance, ctx);
@@ -544,15 +2212,811 @@ void solve(const struct instance_t *instance, struct context_t *ctx)
         }
 
         uncover(instance, ctx, chosen_item);                      /* backtrack */
+        if (ctx->memo != NULL)
+                memo_store(ctx->memo, ctx->covered, (ctx->solutions - solutions) / weight, 
+                                ctx->nodes - nodes);
+        unpropagate_forced(instance, ctx, level);
+}
+
+/*
+ * Diagramme des solutions (--zdd), à la manière de DXZ (Knuth).  La recherche
+ * utilise cover/uncover comme solve, mais chaque noeud renvoie le numéro d'un
+ * noeud du diagramme au lieu de compter : 0 (aucune solution), 1 (la solution
+ * vide), ou une chaîne (option, lo, hi) sur les options de l'objet choisi, où
+ * hi est le diagramme du fils et lo la suite de la chaîne.  Les familles de lo
+ * et de hi sont disjointes (elles couvrent l'objet choisi par des options
+ * différentes), donc le nombre de solutions d'un noeud est la somme de ceux de
+ * lo et de hi, et la k-ième solution se retrouve en descendant le diagramme.
+ * Les options ne sont pas forcément croissantes le long d'un chemin : c'est
+ * un ZDD « libre ».  Les noeuds identiques sont partagés (table d'unicité) et
+ * les sous-problèmes déjà résolus sont retrouvés par la table de --count-memo.
+ */
+#define ZDD_MAGIC "EXCOVZDD"
+#define ZDD_VERSION 1
+
+struct zdd_node_t {
+        int32_t option;           // numéro de l'option dans le fichier d'entrée (-1 : terminal)
+        int32_t lo;               // diagramme sans cette option
+        int32_t hi;               // diagramme du reste une fois l'option choisie
+};
+
+struct zdd_header_t {
+        char magic[8];
+        uint32_t version;
+        uint32_t endian;
+        int32_t n_options;        // nombre d'options de l'instance d'entrée
+        int32_t n_nodes;          // terminaux compris
+        int32_t root;
+        int32_t padding;
+};
+
+struct zdd_t {
+        struct zdd_node_t *node;
+        int n_nodes;
+        int capacity;
+        int *unique;              // table d'unicité : numéros de noeuds (-1 : case libre)
+        size_t unique_mask;
+};
+
+static inline size_t zdd_hash(const struct zdd_t *Z, int option, int lo, int hi)
+{
+        uint64_t h = ((uint64_t) (uint32_t) option * 0x9e3779b97f4a7c15ull) 
+                   ^ ((uint64_t) (uint32_t) lo * 0xc2b2ae3d27d4eb4full) ^ (uint64_t) (uint32_t) hi;
+        h ^= h >> 29;
+        h *= 0xbf58476d1ce4e5b9ull;
+        return (h ^ (h >> 32)) & Z->unique_mask;
+}
+
+static void zdd_rehash(struct zdd_t *Z, size_t size)
+{
+        free(Z->unique);
+        Z->unique = malloc(size * sizeof(int));
+        if (Z->unique == NULL)
+                err(1, "impossible d'allouer la table d'unicité du diagramme");
+        Z->unique_mask = size - 1;
+        for (size_t i = 0; i < size; i++)
+                Z->unique[i] = -1;
+        for (int id = 2; id < Z->n_nodes; id++) {
+                const struct zdd_node_t *x = &Z->node[id];
+                size_t i = zdd_hash(Z, x->option, x->lo, x->hi);
+                while (Z->unique[i] >= 0)
+                        i = (i + 1) & Z->unique_mask;
+                Z->unique[i] = id;
+        }
+}
+
+void zdd_init(struct zdd_t *Z)
+{
+        Z->capacity = 1024;
+        Z->node = malloc(Z->capacity * sizeof(struct zdd_node_t));
+        if (Z->node == NULL)
+                err(1, "impossible d'allouer le diagramme");
+        Z->node[0] = (struct zdd_node_t) {-1, 0, 0};
+        Z->node[1] = (struct zdd_node_t) {-1, 1, 1};
+        Z->n_nodes = 2;
+        Z->unique = NULL;
+        zdd_rehash(Z, 2048);
+}
+
+/* noeud (option, lo, hi), partagé s'il existe déjà */
+int zdd_make(struct zdd_t *Z, int option, int lo, int hi)
+{
+        if (hi == 0)
+                return lo;
+        size_t i = zdd_hash(Z, option, lo, hi);
+        for (; Z->unique[i] >= 0; i = (i + 1) & Z->unique_mask) {
+                const struct zdd_node_t *x = &Z->node[Z->unique[i]];
+                if (x->option == option && x->lo == lo && x->hi == hi)
+                        return Z->unique[i];
+        }
+        if (Z->n_nodes == 0x7fffffff)
+                errx(1, "diagramme trop grand");
+        if (Z->n_nodes == Z->capacity) {
+                Z->capacity = (Z->capacity > 0x3fffffff) ? 0x7fffffff : 2 * Z->capacity;
+                Z->node = realloc(Z->node, Z->capacity * sizeof(struct zdd_node_t));
+                if (Z->node == NULL)
+                        err(1, "impossible d'agrandir le diagramme");
+        }
+        int id = Z->n_nodes++;
+        Z->node[id] = (struct zdd_node_t) {option, lo, hi};
+        Z->unique[i] = id;
+        if (2 * (size_t) Z->n_nodes > Z->unique_mask)
+                zdd_rehash(Z, 2 * (Z->unique_mask + 1));
+        return id;
+}
+
+/* construit le diagramme des solutions du sous-problème courant */
+int solve_zdd(const struct instance_t *instance, struct context_t *ctx, struct zdd_t *Z)
+{
+        ctx->nodes++;
+        if (ctx->nodes == next_report)
+                progress_report(ctx);
+        if (sparse_array_empty(ctx->active_items))
+                return 1;                       /* succès : plus d'objet actif */
+        long long nodes = ctx->nodes;
+        long long known = memo_lookup(ctx->memo, ctx->covered);
+        if (known >= 0)
+                return known;                   /* sous-problème déjà résolu */
+        int chosen_item = choose_next_item(instance, ctx);
+        struct sparse_array_t *active_options = &ctx->active_options[chosen_item];
+        if (sparse_array_empty(active_options))
+                return 0;         /* échec : impossible de couvrir chosen_item */
+        cover(instance, ctx, chosen_item);
+        ctx->num_children[ctx->level] = active_options->len;
+        int chain = 0;
+        for (int k = active_options->len - 1; k >= 0; k--) {
+                int option = item_option(instance, chosen_item, active_options->p[k]);
+                ctx->child_num[ctx->level] = k;
+                choose_option(instance, ctx, option, chosen_item);
+                int child = solve_zdd(instance, ctx, Z);
+                unchoose_option(instance, ctx, option, chosen_item);
+                chain = zdd_make(Z, original_option(instance, option), chain, child);
+        }
+        uncover(instance, ctx, chosen_item);                      /* backtrack */
+        memo_store(ctx->memo, ctx->covered, chain, ctx->nodes - nodes);
+        return chain;
+}
+
+void zdd_write(const struct zdd_t *Z, int root, int n_options, const char *filename)
+{
+        struct zdd_header_t h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, ZDD_MAGIC, 8);
+        h.version = ZDD_VERSION;
+        h.endian = ECB_ENDIAN;
+        h.n_options = n_options;
+        h.n_nodes = Z->n_nodes;
+        h.root = root;
+        FILE *out = fopen(filename, "w");
+        if (out == NULL)
+                err(1, "Impossible d'ouvrir %s en écriture", filename);
+        if (fwrite(&h, sizeof(h), 1, out) != 1 
+                        || fwrite(Z->node, sizeof(struct zdd_node_t), Z->n_nodes, out) != (size_t) Z->n_nodes)
+                err(1, "erreur lors de l'écriture de %s", filename);
+        if (fclose(out) != 0)
+                err(1, "erreur lors de l'écriture de %s", filename);
+}
+
+/* nombre de solutions sous chaque noeud (les fils précèdent toujours leur père) */
+long long * zdd_count(const struct zdd_node_t *node, int n_nodes)
+{
+        long long *count = malloc(n_nodes * sizeof(long long));
+        if (count == NULL)
+                err(1, "impossible d'allouer les compteurs du diagramme");
+        count[0] = 0;
+        count[1] = 1;
+        for (int id = 2; id < n_nodes; id++)
+                count[id] = count[node[id].lo] + count[node[id].hi];
+        return count;
+}
+
+/* lit un diagramme, affiche son nombre de solutions et, si k >= 0, la k-ième */
+void zdd_query(const char *filename, const struct instance_t *instance, long long k)
+{
+        struct text_t text;
+        text_open(&text, filename);
+        const struct zdd_header_t *h = (const struct zdd_header_t *) text.data;
+        if (text.size < sizeof(*h) || memcmp(h->magic, ZDD_MAGIC, 8) != 0)
+                errx(1, "%s : ce n'est pas un diagramme de solutions", filename);
+        if (h->endian != ECB_ENDIAN)
+                errx(1, "%s : diagramme produit sur une machine d'un autre boutisme", filename);
+        if (h->version != ZDD_VERSION)
+                errx(1, "%s : version %u du format de diagramme non supportée", filename, h->version);
+        if (h->n_nodes < 2 || h->root < 0 || h->root >= h->n_nodes
+                        || text.size < sizeof(*h) + h->n_nodes * sizeof(struct zdd_node_t))
+                errx(1, "%s : diagramme tronqué", filename);
+        const struct zdd_node_t *node = (const struct zdd_node_t *) (text.data + sizeof(*h));
+        for (int id = 2; id < h->n_nodes; id++)
+                if (node[id].lo < 0 || node[id].lo >= id || node[id].hi < 1 || node[id].hi >= id
+                                || node[id].option < 0 || node[id].option >= h->n_options)
+                        errx(1, "%s : diagramme incohérent (noeud %d)", filename, id);
+        long long *count = zdd_count(node, h->n_nodes);
+        printf("Diagramme de %d noeuds : %lld solutions\n", h->n_nodes, count[h->root]);
+        if (k >= 0) {
+                if (k >= count[h->root])
+                        errx(1, "pas de solution numéro %lld", k);
+                if (instance != NULL && instance->n_options != h->n_options)
+                        errx(1, "%s : le diagramme ne correspond pas à l'instance", filename);
+                printf("Solution %lld :\n", k);
+                int id = h->root;
+                while (id > 1) {
+                        if (k < count[node[id].hi]) {
+                                printf("+ %d : ", node[id].option);
+                                if (instance != NULL)
+                                        print_option(instance, node[id].option);
+                                else
+                                        printf("\n");
+                                id = node[id].hi;
+                        } else {
+                                k -= count[node[id].hi];
+                                id = node[id].lo;
+                        }
+                }
+        }
+        free(count);
+        text_close(&text);
+}
+
+/*
+ * Moteur bitset, pour les instances d'au plus 256 objets (--engine bitset, ou
+ * automatiquement).  Chaque option est un masque de W mots de 64 bits (W = 1,
+ * 2 ou 4) et chaque noeud dispose de la liste contiguë des options encore
+ * compatibles.  La liste d'un fils s'obtient en filtrant celle du père par
+ * (masque & option choisie) == 0, sans branchement (et avec compress-store
+ * AVX-512 quand W = 1 et que le processeur le permet).  Les listes des noeuds
+ * de la branche courante sont empilées dans un même tampon.
+ */
+#define BITSET_MAX_ITEMS 256
+
+struct bitset_engine_t {
+        uint64_t primary[4];      // masque des objets primaires
+        int n_primary;            // les objets primaires sont les bits 0 .. n_primary - 1
+        uint64_t *mask;           // pile des listes d'options compatibles (W mots par option)
+        int *id;                  // numéro de chaque option de la pile
+        size_t capacity;          // taille de la pile, en options
+        int words;                // nombre de mots par option prévus dans mask (W <= words)
+        bool avx512;              // compress-store AVX-512 disponible
+        struct memo_t *memo;      // --count-memo, clé covered (NULL pour le relais)
+        int split_guard;          // --components : niveau déjà décomposé
+};
+
+/* nombre de mots de 64 bits par option pour n objets */
+static int bitset_words(int n)
+{
+        return (n <= 64) ? 1 : (n <= 128) ? 2 : 4;
 }
 
+static void bitset_reserve(struct bitset_engine_t *B, size_t needed)
+{
+        if (needed <= B->capacity)
+                return;
+        while (B->capacity < needed)
+                B->capacity *= 2;
+        B->mask = realloc(B->mask, B->capacity * B->words * sizeof(uint64_t));
+        B->id = realloc(B->id, B->capacity * sizeof(int));
+        if (B->mask == NULL || B->id == NULL)
+                err(1, "impossible d'agrandir la pile du moteur bitset");
+}
+
+#ifdef __x86_64__
+__attribute__((target("avx512f")))
+static size_t bitset_filter1_avx512(const uint64_t *src, const int *src_id, size_t len,
+                        uint64_t x, uint64_t *dst, int *dst_id)
+{
+        __m512i vx = _mm512_set1_epi64(x);
+        size_t k = 0;
+        size_t i = 0;
+        for (; i + 8 <= len; i += 8) {
+                __m512i v = _mm512_loadu_si512(src + i);
+                __mmask8 keep = _mm512_testn_epi64_mask(v, vx);
+                _mm512_mask_compressstoreu_epi64(dst + k, keep, v);
+                __m512i ids = _mm512_maskz_loadu_epi32(0xff, src_id + i);
+                _mm512_mask_compressstoreu_epi32(dst_id + k, keep, ids);
+                k += __builtin_popcount(keep);
+        }
+        for (; i < len; i++) {
+                dst[k] = src[i];
+                dst_id[k] = src_id[i];
+                k += ((src[i] & x) == 0);
+        }
+        return k;
+}
+#endif
+
+/* recopie dans dst les options de src disjointes de x ; renvoie leur nombre */
+static inline __attribute__((always_inline))
+size_t bitset_filter(const struct bitset_engine_t *B, const uint64_t *src, const int *src_id,
+                        size_t len, const uint64_t *x, uint64_t *dst, int *dst_id, const int W)
+{
+#ifdef __x86_64__
+        if (W == 1 && B->avx512)
+                return bitset_filter1_avx512(src, src_id, len, x[0], dst, dst_id);
+#endif
+        size_t k = 0;
+        for (size_t i = 0; i < len; i++) {
+                uint64_t hit = 0;
+                for (int w = 0; w < W; w++) {
+                        hit |= src[i * W + w] & x[w];
+                        dst[k * W + w] = src[i * W + w];
+                }
+                dst_id[k] = src_id[i];
+                k += (hit == 0);
+        }
+        return k;
+}
+
+static void bitset_solve1(const struct instance_t *instance, struct context_t *ctx,
+                        struct bitset_engine_t *B, const uint64_t *covered, size_t base, size_t len);
+static void bitset_solve2(const struct instance_t *instance, struct context_t *ctx,
+                        struct bitset_engine_t *B, const uint64_t *covered, size_t base, size_t len);
+static void bitset_solve4(const struct instance_t *instance, struct context_t *ctx,
+                        struct bitset_engine_t *B, const uint64_t *covered, size_t base, size_t len);
+
+/*
+ * --components pour le moteur bitset : les objets (bits) sont regroupés par
+ * union-find en une passe sur la liste, chaque option réunissant ses bits.
+ * Chaque composante est comptée sur la liste de ses seules options, les
+ * objets primaires des autres étant marqués couverts (ce qui en fait aussi
+ * une clé correcte pour --count-memo).  Renvoie false s'il n'y a qu'une
+ * composante.
+ */
+static inline int bitset_find(uint8_t *parent, int x)
+{
+        while (parent[x] != x) {
+                parent[x] = parent[parent[x]];
+                x = parent[x];
+        }
+        return x;
+}
+
+static inline __attribute__((always_inline))
+bool bitset_split(const struct instance_t *instance, struct context_t *ctx, struct bitset_engine_t *B,
+                        const uint64_t *covered, size_t base, size_t len, const int W)
+{
+        uint8_t parent[BITSET_MAX_ITEMS];
+        for (int x = 0; x < 64 * W; x++)
+                parent[x] = x;
+        for (size_t i = base; i < base + len; i++) {
+                int root = -1;
+                for (int w = 0; w < W; w++) {
+                        uint64_t bits = B->mask[i * W + w];
+                        while (bits) {
+                                int x = bitset_find(parent, 64 * w + __builtin_ctzll(bits));
+                                if (root < 0)
+                                        root = x;
+                                else if (x != root)
+                                        parent[x] = root;
+                                bits &= bits - 1;
+                        }
+                }
+        }
+
+        /* une composante par racine des objets primaires restants */
+        uint64_t remaining[4];
+        int n_components = 0;
+        for (int w = 0; w < W; w++) {
+                remaining[w] = B->primary[w] & ~covered[w];
+                uint64_t bits = remaining[w];
+                while (bits) {
+                        int x = 64 * w + __builtin_ctzll(bits);
+                        n_components += (bitset_find(parent, x) == x);
+                        bits &= bits - 1;
+                }
+        }
+        /* un objet primaire dont la racine est secondaire ne compte pas ci-dessus */
+        if (n_components <= 1) {
+                int root = -1;
+                bool several = false;
+                for (int w = 0; w < W && !several; w++) {
+                        uint64_t bits = remaining[w];
+                        while (bits) {
+                                int x = bitset_find(parent, 64 * w + __builtin_ctzll(bits));
+                                if (root >= 0 && x != root)
+                                        several = true;
+                                root = x;
+                                bits &= bits - 1;
+                        }
+                }
+                if (!several)
+                        return false;           /* une seule composante */
+        }
+
+        int saved_guard = B->split_guard;
+        B->split_guard = ctx->level;
+        long long weight = solution_weight(instance, ctx);
+        long long solutions = ctx->solutions;
+        long long product = 1;
+        for (int w0 = 0; w0 < W && product != 0; w0++)
+                while (remaining[w0] != 0 && product != 0) {
+                        int root = bitset_find(parent, 64 * w0 + __builtin_ctzll(remaining[w0]));
+                        uint64_t component[4] = {0, 0, 0, 0};
+                        for (int w = w0; w < W; w++) {
+                                uint64_t bits = remaining[w];
+                                while (bits) {
+                                        int x = 64 * w + __builtin_ctzll(bits);
+                                        if (bitset_find(parent, x) == root)
+                                                component[w] |= 1ull << (x & 63);
+                                        bits &= bits - 1;
+                                }
+                        }
+
+                        /* options de la composante, et objets primaires des autres marqués couverts */
+                        uint64_t child_covered[4];
+                        for (int w = 0; w < W; w++) {
+                                remaining[w] &= ~component[w];
+                                child_covered[w] = covered[w] | (B->primary[w] & ~component[w]);
+                        }
+                        size_t child_base = base + len;
+                        bitset_reserve(B, child_base + len);
+                        size_t child_len = 0;
+                        for (size_t i = base; i < base + len; i++) {
+                                uint64_t touch = 0;
+                                for (int w = 0; w < W; w++) {
+                                        B->mask[(child_base + child_len) * W + w] = B->mask[i * W + w];
+                                        touch |= B->mask[i * W + w] & component[w];
+                                }
+                                B->id[child_base + child_len] = B->id[i];
+                                child_len += (touch != 0);
+                        }
+                        if (W == 1)
+                                bitset_solve1(instance, ctx, B, child_covered, child_base, child_len);
+                        else if (W == 2)
+                                bitset_solve2(instance, ctx, B, child_covered, child_base, child_len);
+                        else
+                                bitset_solve4(instance, ctx, B, child_covered, child_base, child_len);
+                        product *= (ctx->solutions - solutions) / weight;
+                        ctx->solutions = solutions;
+                }
+        B->split_guard = saved_guard;
+        ctx->solutions = solutions + weight * product;
+        return true;
+}
+
+/* 
+ * Explore le noeud dont les options compatibles sont les len options situées
+ * en position base de la pile ; covered contient les objets déjà couverts.
+ */
+static inline __attribute__((always_inline))
+void bitset_solve(const struct instance_t *instance, struct context_t *ctx, struct bitset_engine_t *B,
+                        const uint64_t *covered, size_t base, size_t len, const int W)
+{
+        ctx->nodes++;
+        if (ctx->nodes == next_report)
+                progress_report(ctx);
+        long long weight = 0;
+        long long solutions = ctx->solutions;
+        long long nodes = ctx->nodes;
+        if (B->memo != NULL) {
+                weight = solution_weight(instance, ctx);
+                long long count = memo_lookup(B->memo, covered);
+                if (count >= 0) {
+                        ctx->solutions += weight * count;
+                        return;                 /* sous-problème déjà compté */
+                }
+        }
+
+        /* 
+         * Les coups forcés (objet à une seule option) sont posés sur place :
+         * la liste filtrée remplace celle du noeud et l'on recommence, sans
+         * appel récursif.  Le noeud reste indexé dans memo par covered_in.
+         */
+        const uint64_t *covered_in = covered;
+        uint64_t forced_covered[4];
+        int level = ctx->level;
+        int chosen_item;
+        int best;
+        for (;;) {
+                /* objet primaire non couvert ayant le moins d'options compatibles */
+                int count[BITSET_MAX_ITEMS];
+                for (int item = 0; item < B->n_primary; item++)
+                        count[item] = 0;
+                for (size_t i = base; i < base + len; i++)
+                        for (int w = 0; w < W; w++) {
+                                uint64_t bits = B->mask[i * W + w] & B->primary[w];
+                                while (bits) {
+                                        count[64 * w + __builtin_ctzll(bits)]++;
+                                        bits &= bits - 1;
+                                }
+                        }
+                chosen_item = -1;
+                best = 0x7fffffff;
+                for (int w = 0; w < W; w++) {
+                        uint64_t bits = B->primary[w] & ~covered[w];
+                        while (bits) {
+                                int item = 64 * w + __builtin_ctzll(bits);
+                                if (count[item] < best) {
+                                        chosen_item = item;
+                                        best = count[item];
+                                }
+                                bits &= bits - 1;
+                        }
+                }
+                if (best != 1 || !propagate)
+                        break;
+
+                uint64_t item_bit = 1ull << (chosen_item & 63);
+                size_t i = base;
+                while ((B->mask[i * W + (chosen_item >> 6)] & item_bit) == 0)
+                        i++;
+                uint64_t option[4];
+                bool done = true;
+                for (int w = 0; w < W; w++) {
+                        option[w] = B->mask[i * W + w];
+                        forced_covered[w] = covered[w] | option[w];
+                        done &= ((forced_covered[w] & B->primary[w]) == B->primary[w]);
+                }
+                ctx->num_children[ctx->level] = 1;
+                ctx->child_num[ctx->level] = 0;
+                ctx->chosen_options[ctx->level] = B->id[i];
+                ctx->level++;
+                if (done) {
+                        solution_found(instance, ctx);
+                        best = 0;
+                        break;
+                }
+                size_t child_base = base + len;
+                bitset_reserve(B, child_base + len);
+                len = bitset_filter(B, B->mask + base * W, B->id + base, len, option,
+                                        B->mask + child_base * W, B->id + child_base, W);
+                base = child_base;
+                covered = forced_covered;
+                if (len == 0) {
+                        best = 0;       /* échec : il reste des objets primaires mais plus d'option */
+                        break;
+                }
+        }
+        if (best == 0) {
+                ctx->level = level;
+                if (B->memo != NULL && ctx->solutions != solutions)
+                        memo_store(B->memo, covered_in, (ctx->solutions - solutions) / weight, ctx->nodes - nodes);
+                return;           /* échec : impossible de couvrir chosen_item (ou solution forcée) */
+        }
+
+        /* décomposition, seulement si aucun coup n'est forcé */
+        if (split_every > 0 && best > 1 && ctx->level % split_every == 0 && ctx->level != B->split_guard
+                        && bitset_split(instance, ctx, B, covered, base, len, W)) {
+                ctx->level = level;
+                if (B->memo != NULL)
+                        memo_store(B->memo, covered_in, (ctx->solutions - solutions) / weight, ctx->nodes - nodes);
+                return;                         /* produit des composantes */
+        }
+
+        uint64_t item_bit = 1ull << (chosen_item & 63);
+        int item_word = chosen_item >> 6;
+        size_t child_base = base + len;
+        ctx->num_children[ctx->level] = best;
+        int k = 0;
+        for (size_t i = base; i < base + len; i++) {
+                if ((B->mask[i * W + item_word] & item_bit) == 0)
+                        continue;
+                uint64_t option[4];
+                uint64_t child_covered[4];
+                bool done = true;
+                for (int w = 0; w < W; w++) {
+                        option[w] = B->mask[i * W + w];
+                        child_covered[w] = covered[w] | option[w];
+                        done &= ((child_covered[w] & B->primary[w]) == B->primary[w]);
+                }
+                ctx->child_num[ctx->level] = k++;
+                ctx->chosen_options[ctx->level] = B->id[i];
+                ctx->level++;
+                if (done) {
+                        ctx->nodes++;
+                        solution_found(instance, ctx);
+                } else {
+                        bitset_reserve(B, child_base + len);
+                        size_t child_len = bitset_filter(B, B->mask + base * W, B->id + base, len, option,
+                                                B->mask + child_base * W, B->id + child_base, W);
+                        if (child_len == 0)
+                                ;       /* échec : il reste des objets primaires mais plus d'option */
+                        else if (W == 1)
+                                bitset_solve1(instance, ctx, B, child_covered, child_base, child_len);
+                        else if (W == 2)
+                                bitset_solve2(instance, ctx, B, child_covered, child_base, child_len);
+                        else
+                                bitset_solve4(instance, ctx, B, child_covered, child_base, child_len);
+                }
+                ctx->level--;
+                if (ctx->solutions >= max_solutions) {
+                        ctx->level = level;
+                        return;
+                }
+        }
+        ctx->level = level;
+        if (B->memo != NULL)
+                memo_store(B->memo, covered_in, (ctx->solutions - solutions) / weight, ctx->nodes - nodes);
+}
+
+static void bitset_solve1(const struct instance_t *instance, struct context_t *ctx,
+                        struct bitset_engine_t *B, const uint64_t *covered, size_t base, size_t len)
+{
+        bitset_solve(instance, ctx, B, covered, base, len, 1);
+}
+
+static void bitset_solve2(const struct instance_t *instance, struct context_t *ctx,
+                        struct bitset_engine_t *B, const uint64_t *covered, size_t base, size_t len)
+{
+        bitset_solve(instance, ctx, B, covered, base, len, 2);
+}
+
+static void bitset_solve4(const struct instance_t *instance, struct context_t *ctx,
+                        struct bitset_engine_t *B, const uint64_t *covered, size_t base, size_t len)
+{
+        bitset_solve(instance, ctx, B, covered, base, len, 4);
+}
+
+/* résout l'instance (n_items <= BITSET_MAX_ITEMS) ; ctx ne sert que pour les compteurs et le chemin */
+void solve_bitset(const struct instance_t *instance, struct context_t *ctx)
+{
+        int n = instance->n_items;
+        int m = instance->n_options;
+        if (n > BITSET_MAX_ITEMS)
+                errx(1, "moteur bitset : %d objets (maximum %d)", n, BITSET_MAX_ITEMS);
+        int W = bitset_words(n);
+        struct bitset_engine_t B;
+        B.capacity = 4 * (size_t) m + 16;
+        B.words = W;
+        B.mask = calloc(B.capacity * W, sizeof(uint64_t));
+        B.id = malloc(B.capacity * sizeof(int));
+        if (B.mask == NULL || B.id == NULL)
+                err(1, "impossible d'allouer le moteur bitset");
+#ifdef __x86_64__
+        B.avx512 = __builtin_cpu_supports("avx512f");
+#else
+        B.avx512 = false;
+#endif
+        B.n_primary = instance->n_primary;
+        B.memo = ctx->memo;
+        B.split_guard = -1;
+        for (int w = 0; w < 4; w++)
+                B.primary[w] = 0;
+        for (int item = 0; item < instance->n_primary; item++)
+                B.primary[item >> 6] |= 1ull << (item & 63);
+        for (int option = 0; option < m; option++) {
+                for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++) {
+                        int item = instance->options[k];
+                        B.mask[option * W + (item >> 6)] |= 1ull << (item & 63);
+                }
+                B.id[option] = option;
+        }
+        uint64_t covered[4] = {0, 0, 0, 0};
+        bool done = true;
+        for (int w = 0; w < W; w++)
+                done &= (B.primary[w] == 0);
+        if (done) {
+                ctx->nodes++;
+                solution_found(instance, ctx);
+        } else if (W == 1) {
+                bitset_solve1(instance, ctx, &B, covered, 0, m);
+        } else if (W == 2) {
+                bitset_solve2(instance, ctx, &B, covered, 0, m);
+        } else {
+                bitset_solve4(instance, ctx, &B, covered, 0, m);
+        }
+        free(B.mask);
+        free(B.id);
+}
+
+/*
+ * Relais bitset en fond d'arbre (--engine auto sur une instance trop large pour
+ * le moteur bitset).  Quand il ne reste plus que BITSET_TAIL_ITEMS objets
+ * primaires actifs, les options encore actives sont recodées sur les objets
+ * restants (primaires actifs, puis secondaires qu'elles contiennent) et le
+ * sous-arbre est terminé par bitset_solve.  Si le recodage demande plus de
+ * BITSET_MAX_ITEMS bits, solve continue avec les tableaux creux.
+ */
+#define BITSET_TAIL_ITEMS 64
+
+struct bitset_tail_t {
+        struct bitset_engine_t B;
+        int *bit;                 // bit attribué à chaque objet (-1 : aucun)
+        int *touched;             // objets secondaires ayant reçu un bit
+        bool *seen;               // options déjà recopiées
+};
+
+struct bitset_tail_t * bitset_tail_setup(const struct instance_t *instance)
+{
+        struct bitset_tail_t *T = malloc(sizeof(*T));
+        if (T == NULL)
+                err(1, "impossible d'allouer le relais bitset");
+        T->B.capacity = 1024;
+        T->B.words = 4;
+        T->B.memo = NULL;
+        T->B.split_guard = -1;
+        T->B.mask = malloc(T->B.capacity * T->B.words * sizeof(uint64_t));
+        T->B.id = malloc(T->B.capacity * sizeof(int));
+        T->bit = malloc(instance->n_items * sizeof(int));
+        T->touched = malloc(instance->n_items * sizeof(int));
+        T->seen = calloc(instance->n_options, sizeof(bool));
+        if (T->B.mask == NULL || T->B.id == NULL || T->bit == NULL 
+                        || T->touched == NULL || T->seen == NULL)
+                err(1, "impossible d'allouer le relais bitset");
+#ifdef __x86_64__
+        T->B.avx512 = __builtin_cpu_supports("avx512f");
+#else
+        T->B.avx512 = false;
+#endif
+        for (int item = 0; item < instance->n_items; item++)
+                T->bit[item] = -1;
+        return T;
+}
+
+/* termine le noeud courant avec le moteur bitset si possible ; renvoie false sinon */
+bool solve_tail(const struct instance_t *instance, struct context_t *ctx)
+{
+        const struct sparse_array_t *active_items = ctx->active_items;
+        if (active_items->len > BITSET_TAIL_ITEMS || active_items->len == 0)
+                return false;
+        struct bitset_tail_t *T = ctx->tail;
+        struct bitset_engine_t *B = &T->B;
+
+        /* bits des objets primaires actifs, puis des secondaires rencontrés */
+        int n_bits = active_items->len;
+        int n_touched = 0;
+        size_t m = 0;
+        for (int i = 0; i < active_items->len; i++)
+                T->bit[active_items->p[i]] = i;
+        for (int i = 0; i < active_items->len && n_bits <= BITSET_MAX_ITEMS; i++) {
+                int item = active_items->p[i];
+                const struct sparse_array_t *active_options = &ctx->active_options[item];
+                for (int j = 0; j < active_options->len; j++) {
+                        int option = item_option(instance, item, active_options->p[j]);
+                        if (T->seen[option])
+                                continue;
+                        T->seen[option] = true;
+                        bitset_reserve(B, m + 1);
+                        B->id[m++] = option;
+                        for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++) {
+                                int other = instance->options[k];
+                                if (T->bit[other] < 0) {
+                                        T->bit[other] = n_bits++;
+                                        T->touched[n_touched++] = other;
+                                }
+                        }
+                }
+        }
+        for (size_t i = 0; i < m; i++)
+                T->seen[B->id[i]] = false;
+        bool fits = (n_bits <= BITSET_MAX_ITEMS);
+        int W = bitset_words(n_bits);
+        if (fits)
+                for (size_t i = 0; i < m; i++) {
+                        int option = B->id[i];
+                        for (int w = 0; w < W; w++)
+                                B->mask[i * W + w] = 0;
+                        for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++) {
+                                int b = T->bit[instance->options[k]];
+                                B->mask[i * W + (b >> 6)] |= 1ull << (b & 63);
+                        }
+                }
+        for (int i = 0; i < active_items->len; i++)
+                T->bit[active_items->p[i]] = -1;
+        for (int i = 0; i < n_touched; i++)
+                T->bit[T->touched[i]] = -1;
+        if (!fits)
+                return false;
+
+        B->n_primary = active_items->len;
+        for (int w = 0; w < 4; w++) {
+                int lo = 64 * w;
+                B->primary[w] = (B->n_primary <= lo) ? 0 
+                        : (B->n_primary >= lo + 64) ? ~0ull : (1ull << (B->n_primary - lo)) - 1;
+        }
+        uint64_t covered[4] = {0, 0, 0, 0};
+        if (m == 0) {
+                ctx->nodes++;         /* échec : il reste des objets primaires mais plus d'option */
+                if (ctx->nodes == next_report)
+                        progress_report(ctx);
+        } else if (W == 1) {
+                bitset_solve1(instance, ctx, B, covered, 0, m);
+        } else if (W == 2) {
+                bitset_solve2(instance, ctx, B, covered, 0, m);
+        } else {
+                bitset_solve4(instance, ctx, B, covered, 0, m);
+        }
+        return true;
+}
+
+
 int main(int argc, char **argv)
 {
-        struct option longopts[5] = {
+        struct option longopts[17] = {
                 {"in", required_argument, NULL, 'i'},
                 {"progress-report", required_argument, NULL, 'v'},
                 {"print-solutions", no_argument, NULL, 'p'},
                 {"stop-after", required_argument, NULL, 's'},
+                {"compile", required_argument, NULL, 'c'},
+                {"reduce", no_argument, NULL, 'r'},
+                {"renumber", no_argument, NULL, 'n'},
+                {"engine", required_argument, NULL, 'e'},
+                {"count-memo", no_argument, NULL, 'm'},
+                {"components", required_argument, NULL, 'C'},
+                {"zdd", required_argument, NULL, 'z'},
+                {"zdd-read", required_argument, NULL, 'Z'},
+                {"zdd-solution", required_argument, NULL, 'k'},
+                {"no-propagate", no_argument, NULL, 'P'},
+                {"branching", required_argument, NULL, 'b'},
+                {"seed", required_argument, NULL, 'S'},
                 {NULL, 0, NULL, 0}
         };
         char ch;
@@ -570,21 +3034,133 @@ int main(int argc, char **argv)
                 case 'v':
                         report_delta = atoll(optarg);
                         break;          
+                case 'c':
+                        compile_filename = optarg;
+                        break;
+                case 'r':
+                        reduce = true;
+                        break;
+                case 'P':
+                        propagate = false;
+                        break;
+                case 'n':
+                        renumber = true;
+                        break;
+                case 'm':
+                        count_memo = true;
+                        break;
+                case 'C':
+                        split_every = atoi(optarg);
+                        if (split_every < 1)
+                                errx(1, "--components : K doit être au moins 1");
+                        break;
+                case 'z':
+                        zdd_filename = optarg;
+                        break;
+                case 'Z':
+                        zdd_read_filename = optarg;
+                        break;
+                case 'k':
+                        zdd_solution = atoll(optarg);
+                        break;
+                case 'e':
+                        if (strcmp(optarg, "auto") == 0)
+                                engine = ENGINE_AUTO;
+                        else if (strcmp(optarg, "sparse") == 0)
+                                engine = ENGINE_SPARSE;
+                        else if (strcmp(optarg, "bitset") == 0)
+                                engine = ENGINE_BITSET;
+                        else
+                                errx(1, "Moteur inconnu : %s", optarg);
+                        break;
+                case 'b':
+                        if (strcmp(optarg, "mrv") == 0)
+                                branching = BRANCH_MRV;
+                        else if (strcmp(optarg, "mrv-length") == 0)
+                                branching = BRANCH_MRV_LENGTH;
+                        else if (strcmp(optarg, "wdeg") == 0)
+                                branching = BRANCH_WDEG;
+                        else if (strcmp(optarg, "random") == 0)
+                                branching = BRANCH_RANDOM;
+                        else
+                                errx(1, "Heuristique de branchement inconnue : %s", optarg);
+                        break;
+                case 'S':
+                        seed = strtoull(optarg, NULL, 10);
+                        break;
                 default:
                         errx(1, "Unknown option\n");
                 }
         }
+        if (zdd_read_filename != NULL) {
+                struct instance_t *instance = (in_filename != NULL) ? load_matrix(in_filename) : NULL;
+                zdd_query(zdd_read_filename, instance, zdd_solution);
+                exit(EXIT_SUCCESS);
+        }
         if (in_filename == NULL)
                 usage(argv);
+        if (count_memo && print_solutions)
+                errx(1, "--count-memo ne fait que compter : incompatible avec --print-solutions");
+        if (split_every > 0 && (print_solutions || max_solutions != 0x7fffffffffffffff))
+                errx(1, "--components ne fait que compter : incompatible avec --print-solutions et --stop-after");
+        if (zdd_filename != NULL && reduce)
+                errx(1, "--zdd : les options fusionnées par --reduce ne sont pas représentables");
+        if (zdd_filename != NULL && (print_solutions || max_solutions != 0x7fffffffffffffff || split_every > 0))
+                errx(1, "--zdd construit le diagramme de toutes les solutions : incompatible avec --print-solutions, --stop-after et --components");
+        if (zdd_filename != NULL && engine == ENGINE_BITSET)
+                errx(1, "--zdd : le moteur bitset ne sait pas construire le diagramme");
+        if (branching != BRANCH_MRV && engine == ENGINE_BITSET)
+                errx(1, "--branching : le moteur bitset ne connaît que mrv");
         next_report = report_delta;
 
 
         struct instance_t * instance = load_matrix(in_filename);
+        if (compile_filename != NULL) {
+                ecb_write(instance, compile_filename);
+                fprintf(stderr, "Image binaire écrite dans %s\n", compile_filename);
+                exit(EXIT_SUCCESS);
+        }
+        if (reduce)
+                instance = reduce_instance(instance);
+        if (renumber)
+                instance = renumber_instance(instance);
         struct context_t * ctx = backtracking_setup(instance);
+        /* le moteur bitset (et le relais) branche toujours selon mrv */
+        bool use_bitset = (engine == ENGINE_BITSET 
+                        || (engine == ENGINE_AUTO && branching == BRANCH_MRV 
+                                && instance->n_items <= BITSET_MAX_ITEMS));
+        if (engine == ENGINE_AUTO && branching == BRANCH_MRV && !use_bitset)
+                ctx->tail = bitset_tail_setup(instance);
+        if (split_every > 0)
+                ctx->split = split_setup(instance, split_every);
+        /* --zdd a toujours sa propre table, créée plus bas */
+        if (count_memo && zdd_filename == NULL)
+                ctx->memo = memo_setup(use_bitset ? bitset_words(instance->n_items) 
+                                                  : (instance->n_items + 63) / 64);
+        choose_next_item_setup();
         start = wtime();
-        solve(instance, ctx);
+        if (zdd_filename != NULL) {
+                ctx->memo = memo_setup((instance->n_items + 63) / 64);
+                struct zdd_t Z;
+                zdd_init(&Z);
+                int root = solve_zdd(instance, ctx, &Z);
+                const struct instance_t *origin = (instance->origin != NULL) ? instance->origin : instance;
+                zdd_write(&Z, root, origin->n_options, zdd_filename);
+                long long *count = zdd_count(Z.node, Z.n_nodes);
+                printf("FINI. Diagramme de %d noeuds (%lld solutions) écrit dans %s en %.1fs\n", 
+                                Z.n_nodes, count[root], zdd_filename, wtime() - start);
+                exit(EXIT_SUCCESS);
+        }
+        if (use_bitset)
+                solve_bitset(instance, ctx);
+        else
+                solve(instance, ctx);
         printf("FINI. Trouvé %lld solutions en %.1fs\n", ctx->solutions, 
                         wtime() - start);
+        fprintf(stderr, "%lld noeuds explorés\n", ctx->nodes);
+        if (ctx->memo != NULL)
+                fprintf(stderr, "Mémo : %lld sous-problèmes retrouvés, %lld enregistrés\n", 
+                                ctx->memo->hits, ctx->memo->stores);
         exit(EXIT_SUCCESS);
 }
 
@@ -485,6 +485,73 @@ struct instance_t * load_matrix(const char *filename)
         return instance;
 }
 
+/*
+ * Seul le processus 0 lit le fichier ; l'instance est ensuite diffusée aux
+ * autres : ptr et options à leur taille exacte, puis les noms d'objets, mais
+ * seulement s'il faudra afficher des solutions.
+ */
+struct instance_t * broadcast_instance(struct instance_t *instance, int rang)
+{
+        int header[5];          // n_items, n_primary, n_options, ptr[n_options], noms diffusés ?
+        if (rang == 0) {
+                header[0] = instance->n_items;
+                header[1] = instance->n_primary;
+                header[2] = instance->n_options;
+                header[3] = instance->ptr[instance->n_options];
+                header[4] = print_solutions && instance->item_name != NULL;
+        }
+        MPI_Bcast(header, 5, MPI_INT, 0, MPI_COMM_WORLD);
+        if (rang != 0) {
+                instance = malloc(sizeof(*instance));
+                if (instance == NULL)
+                        err(1, "Impossible d'allouer l'instance");
+                instance->n_items = header[0];
+                instance->n_primary = header[1];
+                instance->n_options = header[2];
+                instance->item_name = NULL;
+                instance->ptr = malloc((header[2] + 1) * sizeof(int));
+                instance->options = malloc(header[3] * sizeof(int));
+                if (instance->ptr == NULL || instance->options == NULL)
+                        err(1, "Impossible d'allouer la mémoire pour stocker la matrice");
+        }
+        MPI_Bcast(instance->ptr, header[2] + 1, MPI_INT, 0, MPI_COMM_WORLD);
+        MPI_Bcast(instance->options, header[3], MPI_INT, 0, MPI_COMM_WORLD);
+        if (header[4]) {
+                /* les noms voyagent dans une seule zone, séparés par des '\0' */
+                int size = 0;
+                char *names = NULL;
+                if (rang == 0) {
+                        for (int j = 0; j < header[0]; j++)
+                                size += strlen(instance->item_name[j]) + 1;
+                        names = malloc(size);
+                        if (names == NULL)
+                                err(1, "Impossible d'allouer les noms d'objets");
+                        char *w = names;
+                        for (int j = 0; j < header[0]; j++)
+                                w = stpcpy(w, instance->item_name[j]) + 1;
+                }
+                MPI_Bcast(&size, 1, MPI_INT, 0, MPI_COMM_WORLD);
+                if (rang != 0) {
+                        names = malloc(size);
+                        instance->item_name = malloc(header[0] * sizeof(char *));
+                        if (names == NULL || instance->item_name == NULL)
+                                err(1, "Impossible d'allouer les noms d'objets");
+                }
+                MPI_Bcast(names, size, MPI_CHAR, 0, MPI_COMM_WORLD);
+                if (rang == 0) {
+                        free(names);
+                } else {
+                        char *r = names;
+                        for (int j = 0; j < header[0]; j++) {
+                                instance->item_name[j] = r;
+                                r += strlen(r) + 1;
+                        }
+                }
+        }
+        return instance;
+}
+
+
 
 struct context_t * backtracking_setup(const struct instance_t *instance)
 {
@@ -625,11 +692,14 @@ int main(int argc, char **argv)
         int my_rank;
         MPI_Status status;
         int TAG_DATA = 2;
-        struct instance_t * instance = load_matrix(in_filename);
-        struct context_t * ctx = backtracking_setup(instance);
         MPI_Init(&argc, &argv);
         MPI_Comm_size(MPI_COMM_WORLD, &nb_proc);
         MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+        struct instance_t * instance = NULL;
+        if (my_rank == 0)
+                instance = load_matrix(in_filename);
+        instance = broadcast_instance(instance, my_rank);
+        struct context_t * ctx = backtracking_setup(instance);
 
         start = wtime();
 
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE            // sched_setaffinity, getcpu
 #include <ctype.h>
 #include <stdio.h>
 #include <stdbool.h>
@@ -5,13 +6,23 @@
 #include <stdlib.h>
 #include <err.h>
 #include <getopt.h>
+#include <stdint.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include <omp.h>
 
 #define min(a,b) (a<=b ? a:b)
 #define niveau_max 2
 #define threads omp_get_max_threads
-#define max_taches 1000
+#define SPAWN_SLACK 4          // tâches en attente visées par thread
+#define SPAWN_MIN_ITEMS 8      // pas de tâche pour un sous-problème avec moins d'objets actifs
 
 /* changelog :
 2021-04-12 18:30, instance->n_primary was not properly initialized
@@ -23,9 +34,13 @@ char *in_filename = NULL;              // nom du fichier contenant la matrice
 bool print_solutions = false;          // affiche chaque solution
 long long report_delta = 1e6;          // affiche un rapport tous les ... noeuds
 long long next_report;                 // prochain rapport affiché au noeud...
+long long flush_delta;                 // un thread verse ses compteurs tous les ... noeuds
+long long reported_nodes = 0;          // noeuds versés par les threads
+long long reported_solutions = 0;      // solutions versées par les threads
 long long max_solutions = 0x7fffffffffffffff;        // stop après ... solutions
-
-long long nb_taches_total = 0;
+bool count_memo = false;               // table des sous-problèmes partagée par les threads
+bool pin_threads = false;              // --numa : un thread par coeur, mémoire et vols locaux
+bool huge_pages = false;               // contextes des threads en pages de 2 Mo
 
 
 
@@ -34,8 +49,12 @@ struct instance_t {
         int n_primary;
         int n_options;
         char **item_name;   // potentiellement NULL, sinon de taille n_items
+        char *name_arena;   // zone contenant tous les noms (item_name pointe dedans)
         int *options;       // l'option i contient les objets options[ptr[i]:ptr[i+1]]
         int *ptr;           // taille n_options + 1
+        int *item_ptr;      // les options de l'objet j sont item_options[item_ptr[j]:item_ptr[j+1]]
+        int *item_options;  // taille ptr[n_options]
+        int *local_slot;    // local_slot[k] = rang de l'option dans la liste de l'objet options[k]
 };
 
 struct sparse_array_t {
@@ -45,17 +64,36 @@ struct sparse_array_t {
         int *q;            // taille capacity (tout comme p)
 };
 
+/* 
+ * Tout l'état modifiable d'un contexte vit dans un seul bloc (l'arène), aligné
+ * sur une ligne de cache.  L'ensemble des options actives de l'objet i contient
+ * des rangs locaux 0 <= r < deg(i) et non des numéros d'option : p et q ne font
+ * donc que deg(i) cases au lieu de n_options.
+ */
 struct context_t {
         struct sparse_array_t *active_items;      // objets actifs
-        struct sparse_array_t **active_options;   // options actives contenant l'objet i
+        struct sparse_array_t *active_options;    // options actives (rangs locaux) contenant l'objet i
         int *chosen_options;                      // options choisies à ce stade
+        int *chosen_items;                        // objet sur lequel on a branché à ce stade
         int *child_num;                           // numéro du fils exploré
         int *num_children;                        // nombre de fils à explorer
         int level;                                // nombre d'options choisies
         long long nodes;                          // nombre de noeuds explorés
         long long solutions;                      // nombre de solutions trouvées 
+        long long dead_ends;                      // échecs : objet impossible à couvrir
+        long long next_flush;                     // prochain versement des compteurs, au noeud...
+        long long flushed_nodes;                  // déjà versés dans reported_nodes...
+        long long flushed_solutions;              // ... et reported_solutions
+        uint64_t sig[2];                          // signatures des objets couverts (--count-memo)
+        long long spawned;                        // tâches créées depuis ce contexte
+        struct worker_t *worker;                  // thread propriétaire (NULL : ne crée pas de tâche)
+        char *arena;                              // bloc contenant tous les tableaux ci-dessus
+        size_t arena_size;
 };
 
+#define CACHE_LINE 64
+#define FLUSH_DELTA 65536
+
 static const char DIGITS[62] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
                                 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 
                                 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't',
@@ -80,6 +118,10 @@ void usage(char **argv)
         printf("--progress-report N   display a message every N nodes (0 to disable)\n");
         printf("--print-solutions     display solutions when they are found\n");
         printf("--stop-after N        stop the search once N solutions are found\n");
+        printf("--count-memo          count only, sharing subtree counts between threads\n");
+        printf("--numa                pin one thread per core, keep each context on its NUMA node\n");
+        printf("                      and steal from the same node first\n");
+        printf("--huge-pages          back the per-thread contexts with 2 MB pages\n");
         exit(0);
 }
 
@@ -103,22 +145,22 @@ void print_option(const struct instance_t *instance, int option)
 
 
 
-struct sparse_array_t * sparse_array_init(int n)
+/* installe un tableau creux de capacité n dans la zone p[0:n], q[0:n] (déjà allouée) */
+void sparse_array_bind(struct sparse_array_t *S, int *zone, int n)
 {
-        struct sparse_array_t *S = malloc(sizeof(*S));
-        if (S == NULL)
-                err(1, "impossible d'allouer un tableau creux");
-        S->len = 0;
         S->capacity = n;
-        S->p = malloc(n * sizeof(int));
-        S->q = malloc(n * sizeof(int));
-        if (S->p == NULL || S->q == NULL)
-                err(1, "Impossible d'allouer p/q dans un tableau creux");
-        for (int i = 0; i < n; i++)
-                S->q[i] = n;           // initialement vide
-        return S;
+        S->p = zone;
+        S->q = zone + n;
 }
 
+void sparse_array_clear(struct sparse_array_t *S)
+{
+        S->len = 0;
+        for (int i = 0; i < S->capacity; i++)
+                S->q[i] = S->capacity;           // initialement vide
+}
+
+
 bool sparse_array_membership(const struct sparse_array_t *S, int x)
 {
         return (S->q[x] < S->len);
@@ -215,6 +257,12 @@ void unchoose_option(const struct instance_t *instance, struct context_t *ctx,
 }
 
 
+/* numéro de l'option de rang local r dans la liste de l'objet item */
+static inline int item_option(const struct instance_t *instance, int item, int r)
+{
+        return instance->item_options[instance->item_ptr[item] + r];
+}
+
 int choose_next_item(struct context_t *ctx)
 {
         int best_item = -1;
@@ -222,8 +270,7 @@ int choose_next_item(struct context_t *ctx)
         struct sparse_array_t *active_items = ctx->active_items;
         for (int i = 0; i < active_items->len; i++) {
                 int item = active_items->p[i];
-                struct sparse_array_t *active_options = ctx->active_options[item];
-                int k = active_options->len;
+                int k = ctx->active_options[item].len;
                 if (k < best_options) {
                         best_item = item;
                         best_options = k;
@@ -232,11 +279,12 @@ int choose_next_item(struct context_t *ctx)
         return best_item;
 }
 
-void progress_report(const struct context_t *ctx)
+
+void progress_report(const struct context_t *ctx, long long nodes, long long solutions)
 {
         double now = wtime();
         printf("Exploré %lld noeuds, trouvé %lld solutions, temps écoulé %.1fs. ", 
-                        ctx->nodes, ctx->solutions, now - start);
+                        nodes, solutions, now - start);
         int i = 0;
         for (int k = 0; k < ctx->level; k++) {
                 if (i > 44)
@@ -248,20 +296,51 @@ void progress_report(const struct context_t *ctx)
                 printf("%c%c ", (n < 62) ? DIGITS[n] : '*', (m < 62) ? DIGITS[m] : '*');
                 i++;
         }
-        printf("\n"),
-        next_report += report_delta;
+        printf("\n");
+}
+
+/*
+ * Verse les compteurs de ctx dans les totaux partagés, tous les flush_delta
+ * noeuds et à la fin de chaque tâche : les threads ne partagent rien entre
+ * deux versements.  Celui dont le versement fait franchir next_report au
+ * total avance next_report (CAS) et affiche le rapport.
+ */
+void flush_counters(struct context_t *ctx)
+{
+        long long nodes = __atomic_add_fetch(&reported_nodes, ctx->nodes - ctx->flushed_nodes, 
+                                __ATOMIC_RELAXED);
+        long long solutions = __atomic_add_fetch(&reported_solutions, 
+                                ctx->solutions - ctx->flushed_solutions, __ATOMIC_RELAXED);
+        ctx->flushed_nodes = ctx->nodes;
+        ctx->flushed_solutions = ctx->solutions;
+        ctx->next_flush = ctx->nodes + flush_delta;
+        if (report_delta <= 0)
+                return;                         /* rapports désactivés */
+        long long target = __atomic_load_n(&next_report, __ATOMIC_RELAXED);
+        while (nodes >= target) {
+                long long next = (nodes / report_delta + 1) * report_delta;
+                if (__atomic_compare_exchange_n(&next_report, &target, next, false, 
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                        progress_report(ctx, nodes, solutions);
+                        break;
+                }
+        }
 }
 
 void deactivate(const struct instance_t *instance, struct context_t *ctx, 
                         int option, int covered_item);
 
+static inline void memo_toggle(struct context_t *ctx, int item);
+
 void cover(const struct instance_t *instance, struct context_t *ctx, int item)
 {
+        memo_toggle(ctx, item);
         if (item_is_primary(instance, item))
                 sparse_array_remove(ctx->active_items, item);
-        struct sparse_array_t *active_options = ctx->active_options[item];
+        struct sparse_array_t *active_options = &ctx->active_options[item];
+        const int *item_options = instance->item_options + instance->item_ptr[item];
         for (int i = 0; i < active_options->len; i++) {
-                int option = active_options->p[i];
+                int option = item_options[active_options->p[i]];
                 deactivate(instance, ctx, option, item);
         }
 }
@@ -274,7 +353,7 @@ void deactivate(const struct instance_t *instance, struct context_t *ctx,
                 int item = instance->options[k];
                 if (item == covered_item)
                         continue;
-                sparse_array_remove(ctx->active_options[item], option);
+                sparse_array_remove(&ctx->active_options[item], instance->local_slot[k]);
         }
 }
 
@@ -284,13 +363,15 @@ void reactivate(const struct instance_t *instance, struct context_t *ctx,
 
 void uncover(const struct instance_t *instance, struct context_t *ctx, int item)
 {
-        struct sparse_array_t *active_options = ctx->active_options[item];
+        struct sparse_array_t *active_options = &ctx->active_options[item];
+        const int *item_options = instance->item_options + instance->item_ptr[item];
         for (int i = active_options->len - 1; i >= 0; i--) {
-                int option = active_options->p[i];
+                int option = item_options[active_options->p[i]];
                 reactivate(instance, ctx, option, item);
         }
         if (item_is_primary(instance, item))
                 sparse_array_unremove(ctx->active_items);
+        memo_toggle(ctx, item);
 }
 
 
@@ -301,99 +382,474 @@ void reactivate(const struct instance_t *instance, struct context_t *ctx,
                 int item = instance->options[k];
                 if (item == uncovered_item)
                         continue;
-                sparse_array_unremove(ctx->active_options[item]);
+                sparse_array_unremove(&ctx->active_options[item]);
         }
 }
 
 
+/* construit l'index objet -> options (lecture seule, partagé par tous les contextes) */
+void build_item_index(struct instance_t *instance)
+{
+        int n = instance->n_items;
+        int m = instance->n_options;
+        int total = instance->ptr[m];
+        instance->item_ptr = malloc((n + 1) * sizeof(int));
+        instance->item_options = malloc(total * sizeof(int));
+        instance->local_slot = malloc(total * sizeof(int));
+        int *fill = calloc(n, sizeof(int));
+        if (instance->item_ptr == NULL || instance->item_options == NULL 
+                || instance->local_slot == NULL || fill == NULL)
+                err(1, "impossible d'allouer l'index objet -> options");
+        for (int k = 0; k < total; k++)
+                fill[instance->options[k]]++;
+        instance->item_ptr[0] = 0;
+        for (int item = 0; item < n; item++) {
+                instance->item_ptr[item + 1] = instance->item_ptr[item] + fill[item];
+                fill[item] = 0;
+        }
+        for (int option = 0; option < m; option++)
+                for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++) {
+                        int item = instance->options[k];
+                        int r = fill[item]++;
+                        instance->item_options[instance->item_ptr[item] + r] = option;
+                        instance->local_slot[k] = r;
+                }
+        free(fill);
+}
+
+/* 
+ * Chargement de la matrice.  Le fichier est projeté en mémoire (mmap) quand
+ * c'est possible, et lu d'un bloc sinon (tube, entrée standard...).  Les
+ * lignes sont découpées par memchr et les identifiants par un balayage SSE2
+ * qui cherche le prochain séparateur 16 octets à la fois.  Les noms d'objets
+ * sont recopiés dans une seule zone, et options[] est dimensionné exactement.
+ */
+
+struct text_t {
+        char *data;
+        size_t size;
+        bool mapped;        // data provient de mmap (sinon de malloc)
+};
+
+void text_open(struct text_t *text, const char *filename)
+{
+        int fd = (strcmp(filename, "-") == 0) ? STDIN_FILENO : open(filename, O_RDONLY);
+        if (fd < 0)
+                err(1, "Impossible d'ouvrir %s en lecture", filename);
+        struct stat st;
+        if (fstat(fd, &st) < 0)
+                err(1, "Impossible d'examiner %s", filename);
+        if (S_ISREG(st.st_mode) && st.st_size > 0) {
+                text->size = st.st_size;
+                text->data = mmap(NULL, text->size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (text->data != MAP_FAILED) {
+                        madvise(text->data, text->size, MADV_SEQUENTIAL);
+                        text->mapped = true;
+                        close(fd);
+                        return;
+                }
+        }
+        /* pas de projection possible : on lit tout */
+        size_t capacity = 1 << 16;
+        text->size = 0;
+        text->mapped = false;
+        text->data = malloc(capacity);
+        if (text->data == NULL)
+                err(1, "Impossible d'allouer le tampon de lecture");
+        for (;;) {
+                if (text->size == capacity) {
+                        capacity *= 2;
+                        text->data = realloc(text->data, capacity);
+                        if (text->data == NULL)
+                                err(1, "Impossible d'allouer le tampon de lecture");
+                }
+                ssize_t r = read(fd, text->data + text->size, capacity - text->size);
+                if (r < 0)
+                        err(1, "erreur lors de la lecture de %s", filename);
+                if (r == 0)
+                        break;
+                text->size += r;
+        }
+        if (fd != STDIN_FILENO)
+                close(fd);
+}
+
+void text_close(struct text_t *text)
+{
+        if (text->mapped)
+                munmap(text->data, text->size);
+        else
+                free(text->data);
+}
+
+/* tout octet <= ' ' sépare les identifiants, tout comme | */
+static inline bool is_separator(char c)
+{
+        return (unsigned char) c <= ' ' || c == '|';
+}
+
+/* renvoie l'adresse du premier séparateur dans [p, end), ou end */
+static const char * scan_identifier(const char *p, const char *end)
+{
+#ifdef __SSE2__
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i bar = _mm_set1_epi8('|');
+        while (end - p >= 16) {
+                __m128i x = _mm_loadu_si128((const __m128i *) p);
+                __m128i blank = _mm_cmpeq_epi8(_mm_min_epu8(x, space), x);     // x <= ' '
+                int mask = _mm_movemask_epi8(_mm_or_si128(blank, _mm_cmpeq_epi8(x, bar)));
+                if (mask != 0)
+                        return p + __builtin_ctz(mask);
+                p += 16;
+        }
+#endif
+        while (p < end && !is_separator(*p))
+                p++;
+        return p;
+}
+
+static const char * skip_blanks(const char *p, const char *end)
+{
+        while (p < end && (unsigned char) *p <= ' ')
+                p++;
+        return p;
+}
+
+static const char * read_int(const char *p, const char *end, int *x)
+{
+        p = skip_blanks(p, end);
+        long long v = 0;
+        const char *start = p;
+        while (p < end && *p >= '0' && *p <= '9' && v <= 0x7fffffff) {
+                v = 10 * v + (*p - '0');
+                p++;
+        }
+        if (p == start || v > 0x7fffffff)
+                errx(1, "Erreur de lecture de la taille du problème\n");
+        *x = v;
+        return p;
+}
+
+/* table de hachage nom -> numéro d'objet (adressage ouvert, sondage linéaire) */
+struct name_table_t {
+        unsigned mask;      // taille - 1 (puissance de deux)
+        int *slot;          // numéro d'objet + 1, ou 0 si la case est vide
+};
+
+static inline unsigned hash_name(const char *id, int len)
+{
+        unsigned h = 2166136261u;                 // FNV-1a
+        for (int i = 0; i < len; i++) {
+                h ^= (unsigned char) id[i];
+                h *= 16777619u;
+        }
+        return h;
+}
+
+void name_table_init(struct name_table_t *T, int n)
+{
+        unsigned size = 16;
+        while (size < 2 * (unsigned) n)
+                size *= 2;
+        T->mask = size - 1;
+        T->slot = calloc(size, sizeof(int));
+        if (T->slot == NULL)
+                err(1, "Impossible d'allouer la table des noms");
+}
+
+/* renvoie la case contenant [id, id+len), ou la case vide où l'insérer */
+int * name_table_find(const struct instance_t *instance, const struct name_table_t *T, 
+                        const char *id, int len)
+{
+        unsigned h = hash_name(id, len) & T->mask;
+        while (T->slot[h] != 0) {
+                const char *name = instance->item_name[T->slot[h] - 1];
+                if (strncmp(id, name, len) == 0 && name[len] == '\0')
+                        break;
+                h = (h + 1) & T->mask;
+        }
+        return &T->slot[h];
+}
+
+/*
+ * Format binaire compilé (.ecb) : un en-tête suivi des tableaux de l'instance
+ * tels qu'ils sont en mémoire, chacun aligné sur 64 octets (ptr, options, index
+ * objet -> options et, optionnellement, les noms).  Le chargement projette le
+ * fichier et fait pointer l'instance dedans, sans aucune copie : tous les
+ * processus d'un même noeud partagent ainsi le cache de pages.
+ */
+#define ECB_MAGIC "EXCOVBIN"
+#define ECB_VERSION 1
+#define ECB_ENDIAN 0x01020304
+
+enum ecb_section_t {ECB_PTR, ECB_OPTIONS, ECB_ITEM_PTR, ECB_ITEM_OPTIONS, ECB_LOCAL_SLOT, 
+                    ECB_NAME_OFFSETS, ECB_NAMES, ECB_SECTIONS};
+
+struct ecb_header_t {
+        char magic[8];
+        uint32_t version;
+        uint32_t endian;                // détecte un fichier produit sur une autre architecture
+        int32_t n_items;
+        int32_t n_primary;
+        int32_t n_options;
+        int32_t has_names;
+        int64_t n_entries;              // ptr[n_options]
+        int64_t offset[ECB_SECTIONS];   // position de chaque section dans le fichier
+        int64_t size[ECB_SECTIONS];     // taille de chaque section, en octets
+};
+
+static int64_t align_cache_line(int64_t x)
+{
+        return (x + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+}
+
+bool ecb_detect(const struct text_t *text)
+{
+        return text->size >= 8 && memcmp(text->data, ECB_MAGIC, 8) == 0;
+}
+
+/*
+ * Les tableaux projetés servent tels quels d'indices : on vérifie une fois,
+ * en O(n_entries), que ptr et item_ptr croissent de 0 à n_entries, que chaque
+ * valeur désigne un objet (ou une option) existant et que local_slot renvoie
+ * bien chaque case de options vers son option.  Comme load_matrix, on refuse
+ * un objet répété dans une option et une option sans objet primaire ; enfin
+ * chaque case de item_options doit être désignée par exactement une entrée,
+ * sans quoi deactivate retirerait deux fois la même case.
+ */
+static void ecb_check_arrays(const struct instance_t *instance, int64_t n_entries, const char *filename)
+{
+        int n = instance->n_items;
+        int m = instance->n_options;
+        const int *ptr = instance->ptr;
+        const int *item_ptr = instance->item_ptr;
+        if (ptr[0] != 0 || ptr[m] != n_entries || item_ptr[0] != 0 || item_ptr[n] != n_entries)
+                errx(1, "%s : image binaire incohérente", filename);
+        for (int item = 0; item < n; item++)
+                if (item_ptr[item + 1] < item_ptr[item] || item_ptr[item + 1] > ptr[m])
+                        errx(1, "%s : image binaire incohérente", filename);
+        for (int k = 0; k < ptr[m]; k++)
+                if (instance->item_options[k] < 0 || instance->item_options[k] >= m)
+                        errx(1, "%s : image binaire incohérente", filename);
+        int *stamp = malloc(n * sizeof(int));                   // stamp[j] = dernière option contenant j
+        uint64_t *seen = calloc((n_entries + 63) / 64, sizeof(uint64_t));       // cases de item_options atteintes
+        if ((stamp == NULL && n > 0) || (seen == NULL && n_entries > 0))
+                err(1, "Impossible d'allouer la mémoire pour vérifier l'image");
+        for (int j = 0; j < n; j++)
+                stamp[j] = -1;
+        for (int option = 0; option < m; option++) {
+                if (ptr[option + 1] < ptr[option] || ptr[option + 1] > ptr[m])
+                        errx(1, "%s : image binaire incohérente", filename);
+                bool has_primary = false;
+                for (int k = ptr[option]; k < ptr[option + 1]; k++) {
+                        int item = instance->options[k];
+                        if (item < 0 || item >= n || stamp[item] == option)
+                                errx(1, "%s : image binaire incohérente", filename);
+                        stamp[item] = option;
+                        has_primary |= item_is_primary(instance, item);
+                        int r = instance->local_slot[k];
+                        if (r < 0 || r >= item_ptr[item + 1] - item_ptr[item] 
+                                        || instance->item_options[item_ptr[item] + r] != option)
+                                errx(1, "%s : image binaire incohérente", filename);
+                        int64_t slot = item_ptr[item] + r;
+                        if (seen[slot / 64] & (1ull << (slot % 64)))
+                                errx(1, "%s : image binaire incohérente", filename);
+                        seen[slot / 64] |= 1ull << (slot % 64);
+                }
+                if (!has_primary)
+                        errx(1, "%s : image binaire incohérente (option %d sans objet primaire)", filename, option);
+        }
+        for (int64_t slot = 0; slot < n_entries; slot++)
+                if (!(seen[slot / 64] & (1ull << (slot % 64))))
+                        errx(1, "%s : image binaire incohérente", filename);
+        free(stamp);
+        free(seen);
+}
+
+void ecb_load(struct instance_t *instance, const struct text_t *text, const char *filename)
+{
+        const struct ecb_header_t *h = (const struct ecb_header_t *) text->data;
+        if (text->size < sizeof(*h))
+                errx(1, "%s : image binaire tronquée", filename);
+        if (h->endian != ECB_ENDIAN)
+                errx(1, "%s : image binaire produite sur une machine d'un autre boutisme", filename);
+        if (h->version != ECB_VERSION)
+                errx(1, "%s : version %u du format binaire non supportée", filename, h->version);
+        for (int s = 0; s < ECB_SECTIONS; s++)
+                if (h->offset[s] < 0 || h->size[s] < 0 || (uint64_t) h->offset[s] > text->size
+                                || (uint64_t) h->size[s] > text->size - h->offset[s])
+                        errx(1, "%s : image binaire tronquée", filename);
+        int64_t n_entries = h->n_entries;
+        if (h->n_items < 0 || h->n_primary < 0 || h->n_primary > h->n_items || h->n_options < 0
+                        || n_entries < 0 || n_entries > 0x7fffffff)
+                errx(1, "%s : image binaire incohérente", filename);
+        for (int s = 0; s < ECB_SECTIONS; s++)
+                if (h->offset[s] % sizeof(int) != 0)
+                        errx(1, "%s : image binaire incohérente", filename);
+        if (h->size[ECB_PTR] != (h->n_options + 1) * (int64_t) sizeof(int)
+                        || h->size[ECB_OPTIONS] != n_entries * (int64_t) sizeof(int)
+                        || h->size[ECB_ITEM_PTR] != (h->n_items + 1) * (int64_t) sizeof(int)
+                        || h->size[ECB_ITEM_OPTIONS] != n_entries * (int64_t) sizeof(int)
+                        || h->size[ECB_LOCAL_SLOT] != n_entries * (int64_t) sizeof(int))
+                errx(1, "%s : image binaire incohérente", filename);
+        instance->n_items = h->n_items;
+        instance->n_primary = h->n_primary;
+        instance->n_options = h->n_options;
+        instance->ptr = (int *) (text->data + h->offset[ECB_PTR]);
+        instance->options = (int *) (text->data + h->offset[ECB_OPTIONS]);
+        instance->item_ptr = (int *) (text->data + h->offset[ECB_ITEM_PTR]);
+        instance->item_options = (int *) (text->data + h->offset[ECB_ITEM_OPTIONS]);
+        instance->local_slot = (int *) (text->data + h->offset[ECB_LOCAL_SLOT]);
+        ecb_check_arrays(instance, n_entries, filename);
+        instance->item_name = NULL;
+        instance->name_arena = NULL;
+        if (!h->has_names)
+                return;
+        /* seul le tableau de pointeurs vers les noms est reconstruit */
+        const int *name_offsets = (const int *) (text->data + h->offset[ECB_NAME_OFFSETS]);
+        int64_t names_size = h->size[ECB_NAMES];
+        if (h->size[ECB_NAME_OFFSETS] != h->n_items * (int64_t) sizeof(int)
+                        || (h->n_items > 0 && (names_size == 0 
+                                || text->data[h->offset[ECB_NAMES] + names_size - 1] != '\0')))
+                errx(1, "%s : image binaire incohérente", filename);
+        for (int j = 0; j < h->n_items; j++)
+                if (name_offsets[j] < 0 || name_offsets[j] >= names_size)
+                        errx(1, "%s : image binaire incohérente", filename);
+        instance->name_arena = text->data + h->offset[ECB_NAMES];
+        instance->item_name = malloc(instance->n_items * sizeof(char *));
+        if (instance->item_name == NULL)
+                err(1, "Impossible d'allouer les noms d'objets");
+        for (int j = 0; j < instance->n_items; j++)
+                instance->item_name[j] = instance->name_arena + name_offsets[j];
+}
+
+void ecb_write(const struct instance_t *instance, const char *filename)
+{
+        int n = instance->n_items;
+        int m = instance->n_options;
+        int64_t n_entries = instance->ptr[m];
+        struct ecb_header_t h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, ECB_MAGIC, 8);
+        h.version = ECB_VERSION;
+        h.endian = ECB_ENDIAN;
+        h.n_items = n;
+        h.n_primary = instance->n_primary;
+        h.n_options = m;
+        h.has_names = (instance->item_name != NULL);
+        h.n_entries = n_entries;
+
+        int *name_offsets = NULL;
+        int64_t names_size = 0;
+        if (h.has_names) {
+                name_offsets = malloc(n * sizeof(int));
+                if (name_offsets == NULL)
+                        err(1, "Impossible d'allouer la table des noms");
+                for (int j = 0; j < n; j++) {
+                        name_offsets[j] = instance->item_name[j] - instance->name_arena;
+                        int64_t end = name_offsets[j] + strlen(instance->item_name[j]) + 1;
+                        if (end > names_size)
+                                names_size = end;
+                }
+        }
+        const void *data[ECB_SECTIONS] = {instance->ptr, instance->options, instance->item_ptr,
+                instance->item_options, instance->local_slot, name_offsets, instance->name_arena};
+        h.size[ECB_PTR] = (m + 1) * sizeof(int);
+        h.size[ECB_OPTIONS] = n_entries * sizeof(int);
+        h.size[ECB_ITEM_PTR] = (n + 1) * sizeof(int);
+        h.size[ECB_ITEM_OPTIONS] = n_entries * sizeof(int);
+        h.size[ECB_LOCAL_SLOT] = n_entries * sizeof(int);
+        h.size[ECB_NAME_OFFSETS] = h.has_names ? n * sizeof(int) : 0;
+        h.size[ECB_NAMES] = names_size;
+        int64_t off = align_cache_line(sizeof(h));
+        for (int s = 0; s < ECB_SECTIONS; s++) {
+                h.offset[s] = off;
+                off = align_cache_line(off + h.size[s]);
+        }
+
+        FILE *out = fopen(filename, "w");
+        if (out == NULL)
+                err(1, "Impossible d'ouvrir %s en écriture", filename);
+        static const char zeros[CACHE_LINE];
+        if (fwrite(&h, sizeof(h), 1, out) != 1)
+                err(1, "erreur lors de l'écriture de %s", filename);
+        int64_t pos = sizeof(h);
+        for (int s = 0; s < ECB_SECTIONS; s++) {
+                if (fwrite(zeros, 1, h.offset[s] - pos, out) != (size_t) (h.offset[s] - pos))
+                        err(1, "erreur lors de l'écriture de %s", filename);
+                if (h.size[s] > 0 && fwrite(data[s], 1, h.size[s], out) != (size_t) h.size[s])
+                        err(1, "erreur lors de l'écriture de %s", filename);
+                pos = h.offset[s] + h.size[s];
+        }
+        if (fclose(out) != 0)
+                err(1, "erreur lors de l'écriture de %s", filename);
+        free(name_offsets);
+}
+
 struct instance_t * load_matrix(const char *filename)
 {
         struct instance_t *instance = malloc(sizeof(*instance));
         if (instance == NULL)
                 err(1, "Impossible d'allouer l'instance");
-        FILE *in = fopen(filename, "r");
-        if (in == NULL)
-                err(1, "Impossible d'ouvrir %s en lecture", filename);
+        struct text_t text;
+        text_open(&text, filename);
+        if (ecb_detect(&text)) {
+                ecb_load(instance, &text, filename);       // la projection reste en place
+                fprintf(stderr, "Lu %d objets (%d principaux) et %d options (image binaire)\n", 
+                        instance->n_items, instance->n_primary, instance->n_options);
+                return instance;
+        }
+        const char *cur = text.data;
+        const char *end = text.data + text.size;
+
         int n_it, n_op;
-        if (fscanf(in, "%d %d\n", &n_it, &n_op) != 2)
-                errx(1, "Erreur de lecture de la taille du problème\n");
+        cur = read_int(cur, end, &n_it);
+        cur = read_int(cur, end, &n_op);
         if (n_it == 0 || n_op == 0)
                 errx(1, "Impossible d'avoir 0 objets ou 0 options");
+        cur = skip_blanks(cur, end);
         instance->n_items = n_it;
         instance->n_primary = 0;
         instance->n_options = n_op;
+
+        /* ligne des objets */
+        const char *eol = memchr(cur, '\n', end - cur);
+        if (eol == NULL)
+                errx(1, "Fin de fichier prématurée");
         instance->item_name = malloc(n_it * sizeof(char *));
+        instance->name_arena = malloc(eol - cur + 1);
         instance->ptr = malloc((n_op + 1) * sizeof(int));
-        instance->options = malloc(n_it * n_op *sizeof(int));         // surallocation massive
-        if (instance->item_name == NULL || instance->ptr == NULL || instance->options == NULL)
+        if (instance->item_name == NULL || instance->name_arena == NULL || instance->ptr == NULL)
                 err(1, "Impossible d'allouer la mémoire pour stocker la matrice");
-
-
-        enum state_t {START, ID, WHITESPACE, BAR, ENDLINE, ENDFILE};
-        enum state_t state = START;
-
-        char buffer[256];
-        int i = 0;     // prochain octet disponible du buffer
-        int n = 0;     // dernier octet disponible du buffer
-
-        char id[65];
-        id[64] = 0;    // sentinelle à la fin, quoi qu'il arrive
-        int j = 0;     // longueur de l'identifiant en cours de lecture
-
+        char *name = instance->name_arena;
+        struct name_table_t names;
+        name_table_init(&names, n_it);
         int current_item = 0;
-        while (state != ENDLINE) {
-                enum state_t prev_state = state;
-                if (i >= n) {
-                        n = fread(buffer, 1, 256, in);
-                        if (n == 0) {
-                                if (feof(in)) {
-                                        state = ENDFILE;
-                                }
-                                if (ferror(in))
-                                        err(1, "erreur lors de la lecture de %s", in_filename);
-                        }
-                        i = 0;
-
-                }
-                if (state == ENDFILE) {
-                        // don't examine buffer[i]
-                } else if (buffer[i] == '\n') {
-                        state = ENDLINE;
-                } else if (buffer[i] == '|') {
-                        state = BAR;
-                } else if (isspace(buffer[i])) {
-                        state = WHITESPACE;
-                } else {
-                        state = ID;
-                }
-
-                // traite le caractère lu
-                if (state == ID) {
-                        if (j == 64)
-                                errx(1, "nom d'objet trop long : %s", id);
-                        id[j] = buffer[i];
-                        j++;
-                }
-                if (prev_state == ID && state != ID) {
-                        id[j] = '\0';
-                        if (current_item == instance->n_items)
-                                errx(1, "Objet excedentaire : %s", id);
-                        for (int k = 0; k < current_item; k++)
-                                if (strcmp(id, instance->item_name[k]) == 0)
-                                        errx(1, "Nom d'objets dupliqué : %s", id);
-                        instance->item_name[current_item] = malloc(j+1);
-                        strcpy(instance->item_name[current_item], id);
-                        current_item++;
-                        j = 0;
-
-
-                }
-                if (state == BAR)
+        while (true) {
+                cur = skip_blanks(cur, eol);
+                if (cur == eol)
+                        break;
+                if (*cur == '|') {
                         instance->n_primary = current_item;
-                if (state == ENDFILE)
-                        errx(1, "Fin de fichier prématurée");
-                // passe au prochain caractère
-                i++;
+                        cur++;
+                        continue;
+                }
+                const char *id_end = scan_identifier(cur, eol);
+                int len = id_end - cur;
+                if (len > 64)
+                        errx(1, "nom d'objet trop long : %.64s", cur);
+                if (current_item == instance->n_items)
+                        errx(1, "Objet excedentaire : %.*s", len, cur);
+                int *slot = name_table_find(instance, &names, cur, len);
+                if (*slot != 0)
+                        errx(1, "Nom d'objets dupliqué : %.*s", len, cur);
+                memcpy(name, cur, len);
+                name[len] = '\0';
+                instance->item_name[current_item] = name;
+                *slot = current_item + 1;
+                name += len + 1;
+                current_item++;
+                cur = id_end;
         }
         if (current_item != instance->n_items)
                 errx(1, "Incohérence : %d objets attendus mais seulement %d fournis\n", 
@@ -401,300 +857,896 @@ struct instance_t * load_matrix(const char *filename)
         if (instance->n_primary == 0)
                 instance->n_primary = instance->n_items;
 
+        /* options : une par ligne non vide */
+        size_t capacity = 4 * (size_t) n_op;
+        instance->options = malloc(capacity * sizeof(int));
+        if (instance->options == NULL)
+                err(1, "Impossible d'allouer la mémoire pour stocker la matrice");
+        int *stamp = malloc(n_it * sizeof(int));     // stamp[j] = dernière option contenant j
+        if (stamp == NULL)
+                err(1, "Impossible d'allouer la mémoire pour stocker la matrice");
+        for (int j = 0; j < n_it; j++)
+                stamp[j] = -1;
         int current_option = 0;
-        int p = 0;       // pointeur courant dans instance->options
+        size_t p = 0;       // pointeur courant dans instance->options
         instance->ptr[0] = p;
-        bool has_primary = false;
-        while (state != ENDFILE) {
-                enum state_t prev_state = state;
-                if (i >= n) {
-                        n = fread(buffer, 1, 256, in);
-                        if (n == 0) {
-                                if (feof(in)) {
-                                        state = ENDFILE;
-                                }
-                                if (ferror(in))
-                                        err(1, "erreur lors de la lecture de %s", in_filename);
-                        }
-                        i = 0;
-
-                }
-                if (state == ENDFILE) {
-                        // don't examine buffer[i]
-                } else if (buffer[i] == '\n') {
-                        state = ENDLINE;
-                } else if (buffer[i] == '|') {
-                        state = BAR;
-                } else if (isspace(buffer[i])) {
-                        state = WHITESPACE;
-                } else {
-                        state = ID;
-                }
-
-                // traite le caractère lu
-                if (state == ID) {
-                        if (j == 64)
-                                errx(1, "nom d'objet trop long : %s", id);
-                        id[j] = buffer[i];
-                        j++;
-                }
-                if (prev_state == ID && state != ID) {
-                        id[j] = '\0';
+        cur = eol + 1;
+        while (cur < end) {
+                eol = memchr(cur, '\n', end - cur);
+                if (eol == NULL)
+                        eol = end;
+                bool has_primary = false;
+                while (true) {
+                        cur = skip_blanks(cur, eol);
+                        if (cur == eol)
+                                break;
+                        if (*cur == '|')
+                                errx(1, "Trouvé | dans une option.");
+                        const char *id_end = scan_identifier(cur, eol);
+                        int len = id_end - cur;
                         // identifie le numéro de l'objet en question
-                        int item_number = -1;
-                        for (int k = 0; k < instance->n_items; k++)
-                                if (strcmp(id, instance->item_name[k]) == 0) {
-                                        item_number = k;
-                                        break;
-                                }
+                        int item_number = *name_table_find(instance, &names, cur, len) - 1;
                         if (item_number == -1)
-                                errx(1, "Objet %s inconnu dans l'option #%d", id, current_option);
+                                errx(1, "Objet %.*s inconnu dans l'option #%d", len, cur, current_option);
                         // détecte les objets répétés
-                        for (int k = instance->ptr[current_option]; k < p; k++)
-                                if (item_number == instance->options[k])
-                                        errx(1, "Objet %s répété dans l'option %d\n", 
-                                                        instance->item_name[item_number], current_option);
+                        if (stamp[item_number] == current_option)
+                                errx(1, "Objet %s répété dans l'option %d\n", 
+                                                instance->item_name[item_number], current_option);
+                        stamp[item_number] = current_option;
+                        if (p == capacity) {
+                                capacity *= 2;
+                                instance->options = realloc(instance->options, capacity * sizeof(int));
+                                if (instance->options == NULL)
+                                        err(1, "Impossible d'allouer la mémoire pour stocker la matrice");
+                        }
                         instance->options[p] = item_number;
                         p++;
                         has_primary |= item_is_primary(instance, item_number);
-                        j = 0;
-
-
+                        cur = id_end;
                 }
-                if (state == BAR) {
-                        errx(1, "Trouvé | dans une option.");
+                // esquive les lignes vides
+                if (p > (size_t) instance->ptr[current_option]) {
+                        if (current_option == instance->n_options)
+                                errx(1, "Option excédentaire");
+                        if (!has_primary)
+                                errx(1, "Option %d sans objet primaire\n", current_option);
+                        if (p > 0x7fffffff)
+                                errx(1, "Trop d'entrées dans la matrice");
+                        current_option++;
+                        instance->ptr[current_option] = p;
                 }
-                if ((state == ENDLINE || state == ENDFILE)) {
-                        // esquive les lignes vides
-                        if (p > instance->ptr[current_option]) {
-                                if (current_option == instance->n_options)
-                                        errx(1, "Option excédentaire");
-                                if (!has_primary)
-                                        errx(1, "Option %d sans objet primaire\n", current_option);
-                                current_option++;
-                                instance->ptr[current_option] = p;
-                                has_primary = false;
-
-
-                        }
-                }
-                // passe au prochain caractère
-                i++;
+                cur = eol + 1;
         }
         if (current_option != instance->n_options)
                 errx(1, "Incohérence : %d options attendues mais seulement %d fournies\n", 
                                 instance->n_options, current_option);
+        instance->options = realloc(instance->options, p * sizeof(int));       // taille exacte
+        if (instance->options == NULL)
+                err(1, "Impossible d'allouer la mémoire pour stocker la matrice");
 
-
-        fclose(in);
+        free(stamp);
+        free(names.slot);
+        text_close(&text);
+        build_item_index(instance);
         fprintf(stderr, "Lu %d objets (%d principaux) et %d options\n", 
                 instance->n_items, instance->n_primary, instance->n_options);
         return instance;
 }
 
 
-struct context_t * backtracking_setup(const struct instance_t *instance)
+/* nombre d'entiers réservés pour un tableau creux de capacité n (p et q), arrondi à la ligne de cache */
+static size_t sparse_array_footprint(int n)
+{
+        size_t ints_per_line = CACHE_LINE / sizeof(int);
+        return ((2 * (size_t) n + ints_per_line - 1) / ints_per_line) * ints_per_line;
+}
+
+/*
+ * Découpe l'arène de ctx.  Si base est NULL, se contente de calculer sa taille ;
+ * sinon fait pointer tous les tableaux du contexte dans base.  Ne touche pas au
+ * contenu : après un memcpy d'arène, il suffit de rappeler context_layout.
+ */
+size_t context_layout(const struct instance_t *instance, struct context_t *ctx, char *base)
+{
+        int n = instance->n_items;
+        size_t off = 0;
+        size_t headers = n * sizeof(struct sparse_array_t) + sizeof(struct sparse_array_t);
+        headers = (headers + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        if (base != NULL) {
+                ctx->active_options = (struct sparse_array_t *) base;
+                ctx->active_items = ctx->active_options + n;
+        }
+        off += headers;
+        size_t stack = 4 * (size_t) n * sizeof(int);
+        stack = (stack + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        if (base != NULL) {
+                int *t = (int *) (base + off);
+                ctx->chosen_options = t;
+                ctx->child_num = t + n;
+                ctx->num_children = t + 2 * n;
+                ctx->chosen_items = t + 3 * n;
+        }
+        off += stack;
+        if (base != NULL)
+                sparse_array_bind(ctx->active_items, (int *) (base + off), n);
+        off += sparse_array_footprint(n) * sizeof(int);
+        for (int item = 0; item < n; item++) {
+                int degree = instance->item_ptr[item + 1] - instance->item_ptr[item];
+                if (base != NULL)
+                        sparse_array_bind(&ctx->active_options[item], (int *) (base + off), degree);
+                off += sparse_array_footprint(degree) * sizeof(int);
+        }
+        return off;
+}
+
+/* chaque contexte a ses lignes de cache : les compteurs écrits à chaque noeud ne sont pas partagés */
+static struct context_t * context_alloc()
 {
-        struct context_t *ctx = malloc(sizeof(*ctx));
+        size_t size = (sizeof(struct context_t) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        struct context_t *ctx = aligned_alloc(CACHE_LINE, size);
         if (ctx == NULL)
                 err(1, "impossible d'allouer un contexte");
+        return ctx;
+}
+
+struct context_t * backtracking_setup(const struct instance_t *instance)
+{
+        struct context_t *ctx = context_alloc();
         ctx->level = 0;
         ctx->nodes = 0;
         ctx->solutions = 0;
+        ctx->dead_ends = 0;
+        ctx->next_flush = flush_delta;
+        ctx->flushed_nodes = 0;
+        ctx->flushed_solutions = 0;
+        ctx->sig[0] = ctx->sig[1] = 0;
+        ctx->spawned = 0;
+        ctx->worker = NULL;
         int n = instance->n_items;
-        int m = instance->n_options;
-        ctx->active_options = malloc(n * sizeof(*ctx->active_options));
-        ctx->chosen_options = malloc(n * sizeof(*ctx->chosen_options));
-        ctx->child_num = malloc(n * sizeof(*ctx->child_num));
-        ctx->num_children = malloc(n * sizeof(*ctx->num_children));
-        if (ctx->active_options == NULL || ctx->chosen_options == NULL
-                || ctx->child_num == NULL || ctx->num_children == NULL)
+        ctx->arena_size = context_layout(instance, ctx, NULL);
+        ctx->arena = aligned_alloc(CACHE_LINE, ctx->arena_size);
+        if (ctx->arena == NULL)
                 err(1, "impossible d'allouer le contexte");
-        ctx->active_items = sparse_array_init(n);
+        context_layout(instance, ctx, ctx->arena);
+        sparse_array_clear(ctx->active_items);
         for (int item = 0; item < instance->n_primary; item++)
                 sparse_array_add(ctx->active_items, item);
 
-        for (int item = 0; item < n; item++)
-                ctx->active_options[item] = sparse_array_init(m);
-        for (int option = 0; option < m; option++)
-                for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++) {
-                        int item = instance->options[k];
-                        sparse_array_add(ctx->active_options[item], option);
-                }
-
+        for (int item = 0; item < n; item++) {
+                struct sparse_array_t *active_options = &ctx->active_options[item];
+                sparse_array_clear(active_options);
+                for (int r = 0; r < active_options->capacity; r++)
+                        sparse_array_add(active_options, r);
+        }
+        return ctx;
+}
 
+/*
+ * Arène d'un thread.  Avec --huge-pages, pages de 2 Mo réservées (MAP_HUGETLB)
+ * si le système en a, sinon pages transparentes (madvise) sur une zone
+ * alignée à 2 Mo.  Ces arènes ne sont jamais libérées.
+ */
+static char * arena_alloc(size_t size)
+{
+        if (!huge_pages) {
+                char *arena = aligned_alloc(CACHE_LINE, size);
+                if (arena == NULL)
+                        err(1, "impossible d'allouer le contexte");
+                return arena;
+        }
+        size_t huge = 2 << 20;
+        size = (size + huge - 1) / huge * huge;
+        char *arena = mmap(NULL, size, PROT_READ | PROT_WRITE, 
+                                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (arena != MAP_FAILED)
+                return arena;
+        arena = mmap(NULL, size + huge, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena == MAP_FAILED)
+                err(1, "impossible d'allouer le contexte");
+        arena += (huge - (uintptr_t) arena % huge) % huge;
+        madvise(arena, size, MADV_HUGEPAGE);    /* simple conseil */
+        return arena;
+}
 
+/*
+ * Copie d'un contexte : l'arène ne contient que des entiers et des en-têtes
+ * dont les pointeurs sont refaits par context_layout, donc un memcpy suffit.
+ * La copie est faite par le thread appelant : ses pages sont placées près de
+ * lui (premier contact).
+ */
+struct context_t * context_clone(const struct instance_t *instance, const struct context_t *model)
+{
+        struct context_t *ctx = context_alloc();
+        *ctx = *model;
+        ctx->arena = arena_alloc(ctx->arena_size);
+        memcpy(ctx->arena, model->arena, ctx->arena_size);
+        context_layout(instance, ctx, ctx->arena);
         return ctx;
 }
 
-struct context_t * context_deepcopy(const struct context_t *context, const struct instance_t *instance){
-        struct context_t *ctx = malloc(sizeof(*ctx));
-        if (ctx == NULL)
-                err(1, "impossible d'allouer un contexte");
-        ctx->level = context->level;
-        ctx->nodes = context->nodes;
-        ctx->solutions = context->solutions;
 
-        int n = instance->n_items;
-        int m = instance->n_options;
-        ctx->active_options = malloc(n * sizeof(*ctx->active_options));
-        ctx->chosen_options = malloc(n * sizeof(*ctx->chosen_options));
-        ctx->child_num = malloc(n * sizeof(*ctx->child_num));
-        ctx->num_children = malloc(n * sizeof(*ctx->num_children));
-        if (ctx->active_options == NULL || ctx->chosen_options == NULL
-                || ctx->child_num == NULL || ctx->num_children == NULL)
-                err(1, "impossible d'allouer le contexte");
+/*
+ * Instantané compact d'un contexte : seulement l'état vivant, dans un tableau
+ * plat d'entiers sans pointeur (envoyable tel quel par MPI ou écrivable sur
+ * disque).  Les listes des objets couverts ne servent plus dans le sous-arbre
+ * et ne sont pas sauvées.  Format :
+ *     [0] taille totale (en entiers)   [1] level   [2:6] sig[0], sig[1]
+ *     chosen_options[0:level], chosen_items[0:level]
+ *     n_active, active_items->p[0:n_active]
+ *     n_records, puis pour chaque objet non couvert : item, len, p[0:len]
+ * La restauration amène chaque élément à sa place par un échange, de sorte
+ * que p reste une permutation : le sous-arbre se parcourt normalement, mais on
+ * ne remonte pas au-dessus du niveau restauré ; on revient à la racine par
+ * context_reset.
+ */
+#define SNAPSHOT_HEADER 6
+
+/* marque (mark[i] = 1) les objets couverts par le chemin ; renvoie la taille de l'instantané */
+static size_t snapshot_mark(const struct instance_t *instance, const struct context_t *ctx, unsigned char *mark)
+{
+        for (int i = 0; i < ctx->level; i++) {
+                int option = ctx->chosen_options[i];
+                for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++)
+                        mark[instance->options[k]] = 1;
+        }
+        size_t size = SNAPSHOT_HEADER + 2 * ctx->level + 1 + ctx->active_items->len + 1;
+        for (int i = 0; i < ctx->active_items->len; i++) {
+                int item = ctx->active_items->p[i];
+                size += 2 + ctx->active_options[item].len;
+        }
+        for (int item = instance->n_primary; item < instance->n_items; item++)
+                if (!mark[item])
+                        size += 2 + ctx->active_options[item].len;
+        return size;
+}
+
+/* écrit l'instantané dans buffer (de taille snapshot_mark(...)) et efface les marques */
+void context_snapshot(const struct instance_t *instance, const struct context_t *ctx, 
+                        unsigned char *mark, int *buffer)
+{
+        int *w = buffer + 1;
+        *w++ = ctx->level;
+        *w++ = (int) (ctx->sig[0] >> 32);
+        *w++ = (int) ctx->sig[0];
+        *w++ = (int) (ctx->sig[1] >> 32);
+        *w++ = (int) ctx->sig[1];
+        memcpy(w, ctx->chosen_options, ctx->level * sizeof(int));
+        w += ctx->level;
+        memcpy(w, ctx->chosen_items, ctx->level * sizeof(int));
+        w += ctx->level;
+        const struct sparse_array_t *active_items = ctx->active_items;
+        *w++ = active_items->len;
+        memcpy(w, active_items->p, active_items->len * sizeof(int));
+        w += active_items->len;
+        int *n_records = w++;
+        *n_records = 0;
+        for (int i = 0; i < active_items->len + instance->n_items - instance->n_primary; i++) {
+                int item = (i < active_items->len) ? active_items->p[i] 
+                                                   : instance->n_primary + i - active_items->len;
+                if (mark[item])
+                        continue;
+                const struct sparse_array_t *S = &ctx->active_options[item];
+                *w++ = item;
+                *w++ = S->len;
+                memcpy(w, S->p, S->len * sizeof(int));
+                w += S->len;
+                (*n_records)++;
+        }
+        buffer[0] = w - buffer;
+        for (int i = 0; i < ctx->level; i++) {
+                int option = ctx->chosen_options[i];
+                for (int k = instance->ptr[option]; k < instance->ptr[option + 1]; k++)
+                        mark[instance->options[k]] = 0;
+        }
+}
+
+/* place x en position i de S (p reste une permutation, q suit) */
+static inline void sparse_array_place(struct sparse_array_t *S, int x, int i)
+{
+        int j = S->q[x];
+        int y = S->p[i];
+        S->p[i] = x;
+        S->p[j] = y;
+        S->q[x] = i;
+        S->q[y] = j;
+}
+
+void context_restore(struct context_t *ctx, const int *buffer)
+{
+        const int *r = buffer + 1;
+        ctx->level = *r++;
+        ctx->sig[0] = ((uint64_t) (uint32_t) r[0] << 32) | (uint32_t) r[1];
+        ctx->sig[1] = ((uint64_t) (uint32_t) r[2] << 32) | (uint32_t) r[3];
+        r += 4;
+        memcpy(ctx->chosen_options, r, ctx->level * sizeof(int));
+        r += ctx->level;
+        memcpy(ctx->chosen_items, r, ctx->level * sizeof(int));
+        r += ctx->level;
+        for (int i = 0; i < ctx->level; i++) {
+                ctx->child_num[i] = 0;
+                ctx->num_children[i] = 1;
+        }
+        int n_active = *r++;
+        for (int i = 0; i < n_active; i++)
+                sparse_array_place(ctx->active_items, r[i], i);
+        ctx->active_items->len = n_active;
+        r += n_active;
+        int n_records = *r++;
+        for (int k = 0; k < n_records; k++) {
+                struct sparse_array_t *S = &ctx->active_options[r[0]];
+                int len = r[1];
+                r += 2;
+                for (int i = 0; i < len; i++)
+                        sparse_array_place(S, r[i], i);
+                S->len = len;
+                r += len;
+        }
+}
+
+/* remet ctx à la racine (toutes les options actives), en O(n_items) */
+void context_reset(const struct instance_t *instance, struct context_t *ctx)
+{
+        for (int item = 0; item < instance->n_items; item++)
+                ctx->active_options[item].len = ctx->active_options[item].capacity;
+        ctx->active_items->len = instance->n_primary;
+        ctx->level = 0;
+        ctx->sig[0] = ctx->sig[1] = 0;
+}
 
+/*
+ * Mémoïsation partagée du comptage (--count-memo).  Le sous-arbre d'un noeud
+ * ne dépend que de l'ensemble des objets couverts ; chaque contexte en tient
+ * deux signatures de Zobrist (sig), mises à jour par cover/uncover.  Tous les
+ * threads partagent une table à adressage ouvert sans verrou : une case est
+ * réservée par CAS sur sa clé (sig[0]), puis sa seconde signature et son
+ * compte sont publiés ; une case n'est jamais remplacée.  Seuls les
+ * sous-arbres d'au moins MEMO_MIN_WORK noeuds sont insérés, ce qui limite à
+ * la fois le remplissage et les conflits entre threads.
+ */
+#define MEMO_BYTES (256ll << 20)
+#define MEMO_PROBES 8
+#define MEMO_MIN_WORK 8
+
+struct memo_entry_t {
+        uint64_t key;             // sig[0] du sous-problème (0 : case libre)
+        uint64_t check;           // sig[1], vérifiée à la lecture
+        long long count;          // nombre de solutions + 1 (0 : pas encore publié)
+};
 
-        memcpy(ctx->chosen_options, context->chosen_options, n * sizeof(*ctx->chosen_options));
-        memcpy(ctx->child_num, context->child_num, n * sizeof(*ctx->child_num));
-        memcpy(ctx->num_children, context->num_children, n * sizeof(*ctx->num_children));
+struct memo_t {
+        size_t mask;              // nombre de cases - 1 (puissance de 2)
+        struct memo_entry_t *entries;
+        uint64_t *zobrist;        // deux valeurs aléatoires par objet
+};
 
+struct memo_t *memo = NULL;
 
-        ctx->active_items = sparse_array_init(n);
-        ctx->active_items->len = context->active_items->len;
-        ctx->active_items->capacity = context->active_items->capacity;
-        memcpy(ctx->active_items->p, context->active_items->p, n * sizeof(int));
-        memcpy(ctx->active_items->q, context->active_items->q, n * sizeof(int));
+static uint64_t splitmix64(uint64_t *state)
+{
+        uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+}
 
-        for (int item = 0; item < n; item++){
-                ctx->active_options[item] = sparse_array_init(m);
-        }
-        for (int item = 0; item < n; item++){ //copie du champs active_options
-                
-                ctx->active_options[item]->len = context->active_options[item]->len;
-                ctx->active_options[item]->capacity = context->active_options[item]->capacity;
-                memcpy(ctx->active_options[item]->p, context->active_options[item]->p, m * sizeof(int));
-                memcpy(ctx->active_options[item]->q, context->active_options[item]->q, m * sizeof(int));
+struct memo_t * memo_setup(const struct instance_t *instance)
+{
+        struct memo_t *M = malloc(sizeof(*M));
+        if (M == NULL)
+                err(1, "impossible d'allouer la table de mémoïsation");
+        size_t n_entries = 1;
+        while (2 * n_entries * sizeof(struct memo_entry_t) <= MEMO_BYTES)
+                n_entries *= 2;
+        M->mask = n_entries - 1;
+        M->entries = calloc(n_entries, sizeof(struct memo_entry_t));
+        M->zobrist = malloc(2 * instance->n_items * sizeof(uint64_t));
+        if (M->entries == NULL || M->zobrist == NULL)
+                err(1, "impossible d'allouer la table de mémoïsation");
+        uint64_t state = 0x5eed;
+        for (int i = 0; i < 2 * instance->n_items; i++)
+                M->zobrist[i] = splitmix64(&state);
+        return M;
+}
 
+static inline uint64_t memo_key(const struct context_t *ctx)
+{
+        return (ctx->sig[0] == 0) ? 1 : ctx->sig[0];
+}
 
+/* nombre de solutions mémorisé pour le sous-problème de ctx, ou -1 */
+long long memo_lookup(const struct memo_t *M, const struct context_t *ctx)
+{
+        uint64_t key = memo_key(ctx);
+        size_t i = key & M->mask;
+        for (int probe = 0; probe < MEMO_PROBES; probe++, i = (i + 1) & M->mask) {
+                struct memo_entry_t *e = &M->entries[i];
+                uint64_t k = __atomic_load_n(&e->key, __ATOMIC_ACQUIRE);
+                if (k == 0)
+                        return -1;
+                if (k != key)
+                        continue;
+                long long count = __atomic_load_n(&e->count, __ATOMIC_ACQUIRE);
+                if (count == 0 || __atomic_load_n(&e->check, __ATOMIC_RELAXED) != ctx->sig[1])
+                        return -1;
+                return count - 1;
         }
-        // à voir s'il y a plus efficace...
+        return -1;
+}
 
+void memo_store(struct memo_t *M, const struct context_t *ctx, long long count)
+{
+        uint64_t key = memo_key(ctx);
+        size_t i = key & M->mask;
+        for (int probe = 0; probe < MEMO_PROBES; probe++, i = (i + 1) & M->mask) {
+                struct memo_entry_t *e = &M->entries[i];
+                uint64_t k = 0;
+                if (__atomic_compare_exchange_n(&e->key, &k, key, false, 
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                        __atomic_store_n(&e->check, ctx->sig[1], __ATOMIC_RELAXED);
+                        __atomic_store_n(&e->count, count + 1, __ATOMIC_RELEASE);
+                        return;
+                }
+                if (k == key)
+                        return;         /* déjà là, ou en cours d'écriture par un autre thread */
+        }
+        /* voisinage plein : le sous-problème n'est pas mémorisé */
+}
 
-        return ctx;
+static inline void memo_toggle(struct context_t *ctx, int item)
+{
+        if (memo != NULL) {
+                ctx->sig[0] ^= memo->zobrist[2 * item];
+                ctx->sig[1] ^= memo->zobrist[2 * item + 1];
+        }
 }
 
-void free_context(struct context_t *ctx, const struct instance_t *instance){
-	int n = instance->n_items;
-    int m = instance->n_options;
-    for(int i = 0; i < n; i++){
-    	free(ctx->active_options[i]->p);
-    	free(ctx->active_options[i]->q);
-    	free(ctx->active_options[i]);
-    }
+/*
+ * Ordonnanceur à vol de travail.  Chaque thread possède un contexte
+ * persistant et une deque de Chase-Lev de taille fixe.  Une tâche est un
+ * chemin depuis la racine (au plus TASK_MAX_DEPTH couples objet, option) : le
+ * thread qui l'exécute le rejoue avec cover et choose_option sur son propre
+ * contexte, qui reste ensuite sur ce chemin.  La tâche suivante ne défait et
+ * ne rejoue que ce qui diffère (pour deux frères, une seule option).  Le
+ * propriétaire empile et dépile en bas de sa
+ * deque (les tâches les plus profondes) ; un thread inactif vole en haut de
+ * celle d'un autre, c'est-à-dire les frères non explorés les moins profonds.
+ * Au-delà de TASK_MAX_DEPTH niveaux, la tâche emporte plutôt un instantané
+ * compact du noeud (context_snapshot), pris dans la réserve du thread qui la
+ * crée et rendu à celle-ci par le thread qui l'a exécutée.  Une deque pleine
+ * fait simplement explorer le fils sur place.
+ */
+#define TASK_MAX_DEPTH 24
+#define DEQUE_SIZE 1024           // puissance de 2
+
+struct snapshot_t {
+        struct snapshot_t *next;    // chaînage dans la réserve
+        struct worker_t *owner;     // thread dont la réserve l'a fourni
+        size_t capacity;            // taille de data, en entiers
+        int data[];                 // l'instantané (context_snapshot)
+};
+
+struct task_t {
+        int level;                  // longueur du préfixe
+        int item[TASK_MAX_DEPTH];   // à chaque niveau, l'objet couvert...
+        int option[TASK_MAX_DEPTH]; // ... et l'option choisie pour lui
+        struct snapshot_t *snapshot;// sinon : noeud sauvé, puis item[0] couvert par option[0]
+};
+
+struct deque_t {
+        long long top __attribute__((aligned(CACHE_LINE)));     // prochaine tâche à voler
+        long long bottom __attribute__((aligned(CACHE_LINE)));  // prochaine case libre
+        struct task_t task[DEQUE_SIZE];
+};
+
+struct worker_t {
+        struct deque_t deque;
+        struct context_t *ctx;    // contexte persistant du thread
+        uint64_t rng;             // choix des victimes
+        unsigned char *mark;      // objets couverts, le temps d'un instantané
+        struct snapshot_t *free_snapshots;      // réserve (propriétaire seulement)
+        struct snapshot_t *returned_snapshots;  // rendus par les autres threads (pile sans verrou)
+        int node;                 // noeud NUMA du thread (--numa)
+        int *near;                // autres threads du même noeud, volés en premier
+        int n_near;
+};
 
-    free(ctx->active_items->p);
-    free(ctx->active_items->q);
-    free(ctx->active_items);
+struct worker_t *workers = NULL;
+int n_workers = 0;
+long long pending = 0;            // tâches créées et pas encore terminées
+int idle = 0;                     // threads qui cherchent une tâche
+bool stop = false;                // --stop-after atteint
 
-    free(ctx->num_children);
-    free(ctx->child_num);
-    free(ctx->chosen_options);
-    free(ctx->active_options);
+/* propriétaire seulement */
+bool deque_push(struct deque_t *D, const struct task_t *T)
+{
+        long long b = __atomic_load_n(&D->bottom, __ATOMIC_RELAXED);
+        long long t = __atomic_load_n(&D->top, __ATOMIC_ACQUIRE);
+        if (b - t >= DEQUE_SIZE)
+                return false;
+        D->task[b & (DEQUE_SIZE - 1)] = *T;
+        __atomic_store_n(&D->bottom, b + 1, __ATOMIC_RELEASE);
+        return true;
+}
 
-    free(ctx);
+/* propriétaire seulement */
+bool deque_pop(struct deque_t *D, struct task_t *T)
+{
+        long long b = __atomic_load_n(&D->bottom, __ATOMIC_RELAXED) - 1;
+        __atomic_store_n(&D->bottom, b, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        long long t = __atomic_load_n(&D->top, __ATOMIC_RELAXED);
+        if (t > b) {
+                __atomic_store_n(&D->bottom, b + 1, __ATOMIC_RELAXED);
+                return false;                   /* vide */
+        }
+        *T = D->task[b & (DEQUE_SIZE - 1)];
+        if (t < b)
+                return true;
+        /* dernière tâche : course avec les voleurs */
+        bool won = __atomic_compare_exchange_n(&D->top, &t, t + 1, false, 
+                                __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+        __atomic_store_n(&D->bottom, b + 1, __ATOMIC_RELAXED);
+        return won;
 }
 
+/* n'importe quel thread ; une copie lue pendant que la case est réécrite est rejetée par le CAS */
+bool deque_steal(struct deque_t *D, struct task_t *T)
+{
+        long long t = __atomic_load_n(&D->top, __ATOMIC_ACQUIRE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        long long b = __atomic_load_n(&D->bottom, __ATOMIC_ACQUIRE);
+        if (t >= b)
+                return false;
+        struct task_t copy = D->task[t & (DEQUE_SIZE - 1)];
+        if (!__atomic_compare_exchange_n(&D->top, &t, t + 1, false, 
+                                __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+                return false;
+        *T = copy;
+        return true;
+}
 
+static inline uint64_t xorshift64(uint64_t *state)
+{
+        uint64_t x = *state;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        return *state = x;
+}
 
-void solve(const struct instance_t *instance, struct context_t *ctx, long long * result)
-{       long long * solution_ctx = &(ctx->solutions);
-        ctx->nodes++;
-        if (ctx->nodes == next_report)
-                progress_report(ctx);
-        if (sparse_array_empty(ctx->active_items)) {
-                solution_found(instance, ctx);
-                return;                         /* succès : plus d'objet actif */
+/* un tampon d'au moins size entiers, pris dans la réserve de W */
+struct snapshot_t * snapshot_acquire(struct worker_t *W, size_t size)
+{
+        if (W->free_snapshots == NULL)
+                W->free_snapshots = __atomic_exchange_n(&W->returned_snapshots, NULL, __ATOMIC_ACQUIRE);
+        struct snapshot_t *S = W->free_snapshots;
+        if (S != NULL)
+                W->free_snapshots = S->next;
+        if (S == NULL || S->capacity < size) {
+                free(S);
+                S = malloc(sizeof(*S) + size * sizeof(int));
+                if (S == NULL)
+                        err(1, "impossible d'allouer un instantané");
+                S->owner = W;
+                S->capacity = size;
         }
-        int chosen_item = choose_next_item(ctx);
-        struct sparse_array_t *active_options = ctx->active_options[chosen_item];
-        if (sparse_array_empty(active_options))
-                return;           /* échec : impossible de couvrir chosen_item */
-        cover(instance, ctx, chosen_item);
-        ctx->num_children[ctx->level] = active_options->len;
-        for (int k = 0; k < active_options->len; k++) {
-                if(/*(ctx->level < niveau_max) && */(nb_taches_total < max_taches)){
-                	#pragma omp atomic
-                        nb_taches_total++;
-
-                        int option = active_options->p[k];
-                        struct context_t *ctx_copy = context_deepcopy(ctx, instance);
-                        ctx_copy->child_num[ctx_copy->level] = k;
-                        choose_option(instance, ctx_copy, option, chosen_item);
-                        #pragma omp task
-                        {
-                        solve(instance, ctx_copy, result);
-                        #pragma omp atomic
-                        *result+=ctx_copy->solutions;
-                        free_context(ctx_copy, instance);
-                        }
-                }else{
-                        int option = active_options->p[k];
-                        ctx->child_num[ctx->level] = k;
-                        choose_option(instance, ctx, option, chosen_item);
-                        solve(instance, ctx, result);
-                        if (ctx->solutions >= max_solutions)
-                                return;
-                        unchoose_option(instance, ctx, option, chosen_item);
-                }
+        return S;
+}
+
+/* rend S à la réserve de son propriétaire (W : thread appelant) */
+void snapshot_release(struct worker_t *W, struct snapshot_t *S)
+{
+        struct worker_t *owner = S->owner;
+        if (owner == W) {
+                S->next = W->free_snapshots;
+                W->free_snapshots = S;
+                return;
         }
-        uncover(instance, ctx, chosen_item);                      /* backtrack */
+        S->next = __atomic_load_n(&owner->returned_snapshots, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&owner->returned_snapshots, &S->next, S, true, 
+                                __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+                ;
+}
+
+/* publie le fils option du noeud courant de ctx (objet choisi couvert) comme tâche ; false si impossible */
+bool spawn_child(const struct instance_t *instance, struct context_t *ctx, int option)
+{
+        struct worker_t *W = ctx->worker;
+        if (W == NULL)
+                return false;
+        struct deque_t *D = &W->deque;
+        if (__atomic_load_n(&D->bottom, __ATOMIC_RELAXED) - __atomic_load_n(&D->top, __ATOMIC_RELAXED) 
+                        >= DEQUE_SIZE)
+                return false;
+        struct task_t T;
+        if (ctx->level < TASK_MAX_DEPTH) {
+                T.level = ctx->level + 1;
+                memcpy(T.item, ctx->chosen_items, T.level * sizeof(int));
+                memcpy(T.option, ctx->chosen_options, ctx->level * sizeof(int));
+                T.option[ctx->level] = option;
+                T.snapshot = NULL;
+        } else {
+                T.level = 1;
+                T.item[0] = ctx->chosen_items[ctx->level];
+                T.option[0] = option;
+                size_t size = snapshot_mark(instance, ctx, W->mark);
+                T.snapshot = snapshot_acquire(W, size);
+                context_snapshot(instance, ctx, W->mark, T.snapshot->data);
+        }
+        __atomic_fetch_add(&pending, 1, __ATOMIC_RELAXED);
+        if (deque_push(D, &T))
+                return true;
+        __atomic_fetch_sub(&pending, 1, __ATOMIC_RELAXED);
+        if (T.snapshot != NULL)
+                snapshot_release(W, T.snapshot);
+        return false;
+}
 
+/*
+ * Création paresseuse : on publie un fils seulement s'il manque du travail en
+ * attente (moins de SPAWN_SLACK tâches par thread) ou si un thread attend et
+ * que notre pile est vide.  Au-delà de TASK_MAX_DEPTH, une tâche coûte un
+ * instantané : on n'en crée que pour un thread qui attend.  Les petits
+ * sous-problèmes ne valent pas une tâche.
+ */
+static bool should_spawn(const struct context_t *ctx)
+{
+        struct worker_t *W = ctx->worker;
+        if (W == NULL || ctx->active_items->len < SPAWN_MIN_ITEMS)
+                return false;
+        bool hungry = __atomic_load_n(&idle, __ATOMIC_RELAXED) > 0
+                && __atomic_load_n(&W->deque.bottom, __ATOMIC_RELAXED) 
+                        <= __atomic_load_n(&W->deque.top, __ATOMIC_RELAXED);
+        if (ctx->level >= TASK_MAX_DEPTH)
+                return hungry;
+        return hungry || __atomic_load_n(&pending, __ATOMIC_RELAXED) < SPAWN_SLACK * n_workers;
 }
 
-void solve_reparti(const struct instance_t *instance, struct context_t *ctx, int num_threads, int thread_num, long long * result)
+void solve(const struct instance_t *instance, struct context_t *ctx)
 {
         ctx->nodes++;
-        if (ctx->nodes == next_report)
-                progress_report(ctx);
+        if (ctx->nodes == ctx->next_flush)
+                flush_counters(ctx);
         if (sparse_array_empty(ctx->active_items)) {
                 solution_found(instance, ctx);
                 return;                         /* succès : plus d'objet actif */
         }
+        long long solutions = ctx->solutions;
+        long long nodes = ctx->nodes;
+        long long spawned = ctx->spawned;
+        if (memo != NULL) {
+                long long count = memo_lookup(memo, ctx);
+                if (count >= 0) {
+                        ctx->solutions += count;
+                        return;                 /* sous-problème déjà compté */
+                }
+        }
         int chosen_item = choose_next_item(ctx);
-        struct sparse_array_t *active_options = ctx->active_options[chosen_item];
-        if (sparse_array_empty(active_options))
+        struct sparse_array_t *active_options = &ctx->active_options[chosen_item];
+        if (sparse_array_empty(active_options)) {
+                ctx->dead_ends++;
                 return;           /* échec : impossible de couvrir chosen_item */
+        }
         cover(instance, ctx, chosen_item);
+        ctx->chosen_items[ctx->level] = chosen_item;
         ctx->num_children[ctx->level] = active_options->len;
-        for (int k = thread_num; k < active_options->len; k+=num_threads) {
-                int option = active_options->p[k];
+        /* les derniers fils deviennent des tâches (volées par le haut : les moins profondes d'abord) */
+        int n_inline = active_options->len;
+        while (n_inline > 1 && should_spawn(ctx)) {
+                int option = item_option(instance, chosen_item, active_options->p[n_inline - 1]);
+                if (!spawn_child(instance, ctx, option))
+                        break;
+                ctx->spawned++;
+                n_inline--;
+        }
+        for (int k = 0; k < n_inline; k++) {
+                int option = item_option(instance, chosen_item, active_options->p[k]);
                 ctx->child_num[ctx->level] = k;
                 choose_option(instance, ctx, option, chosen_item);
-                solve(instance, ctx, result);
+                solve(instance, ctx);
                 if (ctx->solutions >= max_solutions)
                         return;
                 unchoose_option(instance, ctx, option, chosen_item);
         }
-       
         uncover(instance, ctx, chosen_item);                      /* backtrack */
+        /* les solutions des tâches créées ne passent pas par ctx : rien à mémoriser */
+        if (memo != NULL && ctx->spawned == spawned && ctx->nodes - nodes >= MEMO_MIN_WORK)
+                memo_store(memo, ctx, ctx->solutions - solutions);
+}
+
+/* exécute une tâche portant un instantané ; ctx revient ensuite à la racine */
+void run_snapshot_task(const struct instance_t *instance, struct worker_t *W, const struct task_t *T)
+{
+        struct context_t *ctx = W->ctx;
+        context_restore(ctx, T->snapshot->data);
+        snapshot_release(W, T->snapshot);
+        ctx->chosen_items[ctx->level] = T->item[0];
+        ctx->child_num[ctx->level] = 0;
+        ctx->num_children[ctx->level] = 1;
+        choose_option(instance, ctx, T->option[0], T->item[0]);
+        solve(instance, ctx);
+        if (ctx->solutions >= max_solutions)
+                __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+        else
+                context_reset(instance, ctx);
+}
+
+/* amène ctx sur le chemin de T en partant du chemin courant, puis explore le sous-arbre */
+void run_task(const struct instance_t *instance, struct context_t *ctx, const struct task_t *T)
+{
+        int common = 0;
+        while (common < ctx->level && common < T->level && ctx->chosen_items[common] == T->item[common]
+                        && ctx->chosen_options[common] == T->option[common])
+                common++;
+        /* même objet au premier niveau qui diffère : il reste couvert, seule l'option change */
+        bool same_item = (common < ctx->level && common < T->level 
+                        && ctx->chosen_items[common] == T->item[common]);
+        while (ctx->level > common) {
+                int item = ctx->chosen_items[ctx->level - 1];
+                unchoose_option(instance, ctx, ctx->chosen_options[ctx->level - 1], item);
+                if (ctx->level > common || !same_item)
+                        uncover(instance, ctx, item);
+        }
+        for (int i = common; i < T->level; i++) {
+                if (i > common || !same_item)
+                        cover(instance, ctx, T->item[i]);
+                ctx->chosen_items[i] = T->item[i];
+                ctx->child_num[i] = 0;
+                ctx->num_children[i] = 1;
+                choose_option(instance, ctx, T->option[i], T->item[i]);
+        }
+        solve(instance, ctx);
+        if (ctx->solutions >= max_solutions)
+                __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+}
+
+bool steal_task(struct worker_t *W, struct task_t *T)
+{
+        for (int attempt = 0; attempt < 2 * W->n_near; attempt++) {
+                struct worker_t *victim = &workers[W->near[xorshift64(&W->rng) % W->n_near]];
+                if (deque_steal(&victim->deque, T))
+                        return true;
+        }
+        for (int attempt = 0; attempt < 2 * n_workers; attempt++) {
+                struct worker_t *victim = &workers[xorshift64(&W->rng) % n_workers];
+                if (victim != W && deque_steal(&victim->deque, T))
+                        return true;
+        }
+        return false;
+}
 
+void worker_loop(const struct instance_t *instance, struct worker_t *W)
+{
+        struct task_t T;
+        bool waiting = false;
+        while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+                if (!deque_pop(&W->deque, &T) && !steal_task(W, &T)) {
+                        if (!waiting) {
+                                __atomic_fetch_add(&idle, 1, __ATOMIC_RELAXED);
+                                waiting = true;
+                        }
+                        if (__atomic_load_n(&pending, __ATOMIC_ACQUIRE) == 0)
+                                break;          /* plus aucune tâche nulle part */
+                        sched_yield();
+                        continue;
+                }
+                if (waiting) {
+                        __atomic_fetch_sub(&idle, 1, __ATOMIC_RELAXED);
+                        waiting = false;
+                }
+                if (T.snapshot != NULL)
+                        run_snapshot_task(instance, W, &T);
+                else
+                        run_task(instance, W->ctx, &T);
+                flush_counters(W->ctx);
+                __atomic_fetch_sub(&pending, 1, __ATOMIC_RELEASE);
+        }
 }
 
-void solve_para(const struct instance_t *instance, struct context_t ** ctx_tableau, int nb_t, long long * nb_solution){
+/*
+ * --numa : le thread i est fixé sur le i-ème processeur autorisé au processus
+ * (allowed_cpus, lu avant tout placement), à chaque région parallèle, de
+ * sorte que le même processeur retrouve toujours la même arène, remplie par
+ * lui (premier contact : mémoire du noeud local).  Renvoie le noeud NUMA.
+ */
+cpu_set_t allowed_cpus;
+
+int pin_thread(int i)
+{
+        int target = i % CPU_COUNT(&allowed_cpus);
+        int cpu = 0;
+        for (int seen = 0; ; cpu++)
+                if (CPU_ISSET(cpu, &allowed_cpus) && seen++ == target)
+                        break;
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        if (sched_setaffinity(0, sizeof(one), &one) != 0)
+                err(1, "impossible de fixer le thread %d sur le processeur %d", i, cpu);
+        unsigned int current, node;
+        if (getcpu(&current, &node) != 0)
+                return 0;
+        return node;
+}
 
-        for(int i = 0; i < nb_t; i++){
-                #pragma omp task
-                solve_reparti(instance, ctx_tableau[i], nb_t, i, nb_solution);
+void workers_setup(const struct instance_t *instance, int n)
+{
+        n_workers = n;
+        workers = aligned_alloc(CACHE_LINE, n * sizeof(struct worker_t));
+        if (workers == NULL)
+                err(1, "impossible d'allouer les threads");
+        if (pin_threads && sched_getaffinity(0, sizeof(allowed_cpus), &allowed_cpus) != 0)
+                err(1, "sched_getaffinity");
+        /* un seul contexte construit, puis recopié par chaque thread pour lui-même */
+        struct context_t *model = backtracking_setup(instance);
+        #pragma omp parallel for num_threads(n) schedule(static, 1)
+        for (int i = 0; i < n; i++) {
+                struct worker_t *W = &workers[i];
+                W->node = pin_threads ? pin_thread(i) : 0;
+                W->deque.top = 0;
+                W->deque.bottom = 0;
+                W->ctx = context_clone(instance, model);
+                W->ctx->worker = W;
+                W->rng = 0x9e3779b97f4a7c15ull * (i + 1);
+                W->mark = calloc(instance->n_items, 1);
+                if (W->mark == NULL)
+                        err(1, "impossible d'allouer les threads");
+                W->free_snapshots = NULL;
+                W->returned_snapshots = NULL;
+        }
+        free(model->arena);
+        free(model);
+        for (int i = 0; i < n; i++) {
+                struct worker_t *W = &workers[i];
+                W->near = NULL;
+                W->n_near = 0;
+                if (!pin_threads)
+                        continue;
+                W->near = malloc(n * sizeof(int));
+                if (W->near == NULL)
+                        err(1, "impossible d'allouer les threads");
+                for (int j = 0; j < n; j++)
+                        if (j != i && workers[j].node == W->node)
+                                W->near[W->n_near++] = j;
         }
-        #pragma omp taskwait
+}
 
-        //*nb_solution = 0;
-        for(int i = 0; i < nb_t; i++){
-                #pragma omp atomic
-                *nb_solution += ctx_tableau[i]->solutions;
+/* lance les threads sur les tâches déjà déposées (pending à jour) et renvoie le nombre de solutions */
+long long run_workers(const struct instance_t *instance)
+{
+        #pragma omp parallel num_threads(n_workers)
+        {
+                int i = omp_get_thread_num();
+                if (pin_threads)
+                        pin_thread(i);
+                worker_loop(instance, &workers[i]);
         }
+        long long solutions = 0;
+        for (int i = 0; i < n_workers; i++)
+                solutions += workers[i].ctx->solutions;
+        return solutions;
 }
 
+/* statistiques exactes de chaque thread, sur la sortie d'erreur */
+void workers_report()
+{
+        for (int i = 0; i < n_workers; i++) {
+                const struct context_t *ctx = workers[i].ctx;
+                fprintf(stderr, "Thread %d : %lld noeuds, %lld solutions, %lld échecs, %lld tâches créées\n", 
+                                i, ctx->nodes, ctx->solutions, ctx->dead_ends, ctx->spawned);
+        }
+}
 
 int main(int argc, char **argv)
 {
-        struct option longopts[5] = {
+        struct option longopts[8] = {
                 {"in", required_argument, NULL, 'i'},
                 {"progress-report", required_argument, NULL, 'v'},
                 {"print-solutions", no_argument, NULL, 'p'},
                 {"stop-after", required_argument, NULL, 's'},
+                {"count-memo", no_argument, NULL, 'm'},
+                {"numa", no_argument, NULL, 'N'},
+                {"huge-pages", no_argument, NULL, 'H'},
                 {NULL, 0, NULL, 0}
         };
         char ch;
@@ -712,45 +1764,51 @@ int main(int argc, char **argv)
                 case 'v':
                         report_delta = atoll(optarg);
                         break;          
+                case 'm':
+                        count_memo = true;
+                        break;
+                case 'N':
+                        pin_threads = true;
+                        break;
+                case 'H':
+                        huge_pages = true;
+                        break;
                 default:
                         errx(1, "Unknown option\n");
                 }
         }
         if (in_filename == NULL)
                 usage(argv);
+        if (count_memo && print_solutions)
+                errx(1, "--count-memo ne fait que compter : incompatible avec --print-solutions");
         next_report = report_delta;
+        flush_delta = (report_delta > 0) ? min(report_delta, FLUSH_DELTA) : FLUSH_DELTA;
 
         int nb_thread = omp_get_max_threads(); //choix du nombre de threads
 
         struct instance_t * instance = load_matrix(in_filename);
-        struct context_t * ctx = backtracking_setup(instance);
-        struct context_t ** ctx_tab = (struct context_t **)malloc(nb_thread*sizeof(struct context_t *));
-
-
-        
+        if (count_memo)
+                memo = memo_setup(instance);
+        workers_setup(instance, nb_thread);
 
-        for(int i = 0; i < nb_thread; i++){
-                ctx_tab[i] = backtracking_setup(instance);
-        }
-
-
-        long long solutions_total = 0; //nombre de solution trouvé (la somme de tous les ctx->solutions)
+        /* une seule tâche au départ : la racine, chez le thread 0 */
+        struct task_t root = {.level = 0};
+        pending = 1;
+        deque_push(&workers[0].deque, &root);
 
-        
         start = wtime();
-
-        //solve(instance, ctx);
-
-        #pragma omp parallel num_threads(nb_thread)
-        #pragma omp single
-        solve_para(instance, ctx_tab, nb_thread,&solutions_total);
+        long long solutions_total = run_workers(instance); //nombre de solution trouvé (la somme de tous les ctx->solutions)
 
         //printf("FINI. Trouvé %lld solutions en %.1fs\n", ctx->solutions, 
         //                wtime() - start);
         printf("FINI. Trouvé %lld solutions en %.1fs\n", solutions_total, 
                         wtime() - start);
 
+        long long nb_taches_total = 0;
+        for (int i = 0; i < n_workers; i++)
+                nb_taches_total += workers[i].ctx->spawned;
         printf("Nombre total de taches : %lld\n", nb_taches_total);
+        workers_report();
 
         exit(EXIT_SUCCESS);
 }